@@ -0,0 +1,236 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <numeric>
+
+namespace
+{
+	double secondsFor( const BenchmarkBody &body, std::uint64_t iterations )
+	{
+		auto begin = std::chrono::steady_clock::now();
+		body( iterations );
+		std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - begin;
+		return elapsed.count();
+	}
+
+	void writeJsonString( std::ostream &out, const std::string &text )
+	{
+		out << '"';
+		for( char c : text )
+		{
+			if( c == '"' || c == '\\' )
+				out << '\\';
+			out << c;
+		}
+		out << '"';
+	}
+
+	// Just enough JSON to read back our own lines: finds "key": and parses the value after it.
+	bool findValue( const std::string &line, const std::string &key, size_t &position )
+	{
+		auto found = line.find( "\"" + key + "\":" );
+		if( found == std::string::npos )
+			return false;
+		position = line.find_first_not_of( ' ', found + key.size() + 3 );
+		return position != std::string::npos;
+	}
+
+	bool readString( const std::string &line, const std::string &key, std::string &value )
+	{
+		size_t position;
+		if( !findValue( line, key, position ) || line[ position ] != '"' )
+			return false;
+		value.clear();
+		for( ++position; position < line.size() && line[ position ] != '"'; ++position )
+		{
+			if( line[ position ] == '\\' && position + 1 < line.size() )
+				++position;
+			value += line[ position ];
+		}
+		return position < line.size();
+	}
+
+	bool readNumber( const std::string &line, const std::string &key, double &value )
+	{
+		size_t position;
+		if( !findValue( line, key, position ) )
+			return false;
+		const char *begin = line.c_str() + position;
+		char *end;
+		value = std::strtod( begin, &end );
+		return end != begin;
+	}
+}
+
+BenchmarkResult BenchmarkResult::summarize( std::string name, std::uint64_t iterations, std::vector< double > samples )
+{
+	BenchmarkResult result;
+	result.name = std::move( name );
+	result.iterations = iterations;
+	result.repetitions = static_cast< unsigned >( samples.size() );
+	if( samples.empty() )
+		return result;
+
+	std::sort( samples.begin(), samples.end() );
+	size_t count = samples.size();
+	result.min_ns = samples.front();
+	result.max_ns = samples.back();
+	result.median_ns = ( count % 2 ) ? samples[ count / 2 ] : ( samples[ count / 2 - 1 ] + samples[ count / 2 ] ) / 2.0;
+	result.mean_ns = std::accumulate( samples.begin(), samples.end(), 0.0 ) / count;
+
+	// Sample standard deviation; a single repetition has none.
+	if( count > 1 )
+	{
+		double squares = 0.0;
+		for( double sample : samples )
+			squares += ( sample - result.mean_ns ) * ( sample - result.mean_ns );
+		result.stddev_ns = std::sqrt( squares / ( count - 1 ) );
+	}
+	return result;
+}
+
+std::ostream &operator<<( std::ostream &out, const BenchmarkResult &result )
+{
+	auto flags = out.flags();
+	auto precision = out.precision();
+	out << std::left << std::setw( 36 ) << result.name << std::right << std::fixed << std::setprecision( 1 )
+		<< " median " << std::setw( 13 ) << result.median_ns << " ns"
+		<< "  +/- " << std::setw( 5 ) << ( result.mean_ns > 0.0 ? 100.0 * result.stddev_ns / result.mean_ns : 0.0 ) << "%"
+		<< "  min " << std::setw( 13 ) << result.min_ns
+		<< "  mean " << std::setw( 13 ) << result.mean_ns
+		<< "  (" << result.repetitions << " x " << result.iterations << ")";
+	out.flags( flags );
+	out.precision( precision );
+	return out;
+}
+
+void writeJsonLine( std::ostream &out, const BenchmarkResult &result )
+{
+	auto precision = out.precision( 17 );
+	out << "{\"name\": ";
+	writeJsonString( out, result.name );
+	out << ", \"iterations\": " << result.iterations << ", \"repetitions\": " << result.repetitions
+		<< ", \"min_ns\": " << result.min_ns << ", \"median_ns\": " << result.median_ns
+		<< ", \"mean_ns\": " << result.mean_ns << ", \"stddev_ns\": " << result.stddev_ns
+		<< ", \"max_ns\": " << result.max_ns << "}" << std::endl;
+	out.precision( precision );
+}
+
+std::vector< BenchmarkResult > readJsonLines( std::istream &in )
+{
+	std::vector< BenchmarkResult > results;
+	std::string line;
+	while( std::getline( in, line ) )
+	{
+		BenchmarkResult result;
+		if( !readString( line, "name", result.name ) || !readNumber( line, "median_ns", result.median_ns ) )
+			continue;
+
+		double value;
+		if( readNumber( line, "iterations", value ) )
+			result.iterations = static_cast< std::uint64_t >( value );
+		if( readNumber( line, "repetitions", value ) )
+			result.repetitions = static_cast< unsigned >( value );
+		readNumber( line, "min_ns", result.min_ns );
+		readNumber( line, "mean_ns", result.mean_ns );
+		readNumber( line, "stddev_ns", result.stddev_ns );
+		readNumber( line, "max_ns", result.max_ns );
+		results.push_back( std::move( result ) );
+	}
+	return results;
+}
+
+unsigned compareToBaseline( const std::vector< BenchmarkResult > &results, const std::vector< BenchmarkResult > &baseline,
+	double threshold, std::ostream &out )
+{
+	auto flags = out.flags();
+	auto precision = out.precision();
+	out << std::fixed << std::setprecision( 1 );
+
+	unsigned regressions = 0;
+	for( const auto &result : results )
+	{
+		out << std::left << std::setw( 36 ) << result.name << std::right;
+		auto before = std::find_if( baseline.begin(), baseline.end(),
+			[&result]( const BenchmarkResult &entry ) { return entry.name == result.name; } );
+		if( before == baseline.end() || before->median_ns <= 0.0 )
+		{
+			out << "  no baseline" << std::endl;
+			continue;
+		}
+
+		double change = result.median_ns / before->median_ns - 1.0;
+		out << std::setw( 13 ) << before->median_ns << " ns -> " << std::setw( 13 ) << result.median_ns << " ns  "
+			<< std::showpos << std::setw( 7 ) << 100.0 * change << "%" << std::noshowpos;
+		if( change > threshold )
+		{
+			out << "  REGRESSION";
+			++regressions;
+		}
+		else if( change < -threshold )
+		{
+			out << "  faster";
+		}
+		out << std::endl;
+	}
+
+	out.flags( flags );
+	out.precision( precision );
+	return regressions;
+}
+
+BenchmarkRunner::BenchmarkRunner( BenchmarkOptions options ) : mOptions{ std::move( options ) }
+{
+}
+
+void BenchmarkRunner::add( std::string name, BenchmarkSetup setup )
+{
+	mBenchmarks.emplace_back( std::move( name ), std::move( setup ) );
+}
+
+std::vector< std::string > BenchmarkRunner::names() const
+{
+	std::vector< std::string > names;
+	for( const auto &[ name, setup ] : mBenchmarks )
+		names.push_back( name );
+	return names;
+}
+
+std::vector< BenchmarkResult > BenchmarkRunner::run( const std::function< void( const BenchmarkResult & ) > &report ) const
+{
+	std::vector< BenchmarkResult > results;
+	for( const auto &[ name, setup ] : mBenchmarks )
+	{
+		if( name.find( mOptions.filter ) == std::string::npos )
+			continue;
+
+		auto body = setup();
+
+		// Calibrate: grow the iteration count, aiming a little past the minimum so noise
+		// doesn't leave repetitions just short of it.
+		std::uint64_t iterations = 1;
+		for( ;; )
+		{
+			double seconds = secondsFor( body, iterations );
+			if( seconds >= mOptions.min_repetition_seconds )
+				break;
+			double scale = ( seconds > 0.0 ) ? 1.2 * mOptions.min_repetition_seconds / seconds : 10.0;
+			iterations = std::max( iterations + 1, static_cast< std::uint64_t >( iterations * std::min( scale, 10.0 ) ) );
+		}
+
+		for( unsigned i = 0; i < mOptions.warmup; ++i )
+			secondsFor( body, iterations );
+
+		std::vector< double > samples;
+		for( unsigned i = 0; i < std::max( 1u, mOptions.repetitions ); ++i )
+			samples.push_back( 1e9 * secondsFor( body, iterations ) / iterations );
+
+		results.push_back( BenchmarkResult::summarize( name, iterations, std::move( samples ) ) );
+		report( results.back() );
+	}
+	return results;
+}
@@ -0,0 +1,85 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Small microbenchmark harness. Each benchmark is calibrated to a number of iterations that
+// takes long enough to time, run a few times to warm up, then timed over several repetitions
+// and summarised as nanoseconds per iteration. Results can be written as JSON lines, one
+// object per benchmark, and compared against a saved set of them.
+
+// Runs the operation being measured `iterations` times.
+using BenchmarkBody = std::function< void( std::uint64_t iterations ) >;
+// Builds whatever the benchmark needs and returns its body. Only called if the benchmark runs,
+// and never timed.
+using BenchmarkSetup = std::function< BenchmarkBody() >;
+
+struct BenchmarkOptions
+{
+	unsigned warmup = 2;
+	unsigned repetitions = 10;
+	// Iterations per repetition grow until one repetition takes at least this long.
+	double min_repetition_seconds = 0.02;
+	// Only benchmarks whose names contain this are run.
+	std::string filter;
+};
+
+// Nanoseconds per iteration, over the timed repetitions.
+struct BenchmarkResult
+{
+	std::string name;
+	std::uint64_t iterations = 0;
+	unsigned repetitions = 0;
+	double min_ns = 0.0;
+	double median_ns = 0.0;
+	double mean_ns = 0.0;
+	double stddev_ns = 0.0;
+	double max_ns = 0.0;
+
+	static BenchmarkResult summarize( std::string name, std::uint64_t iterations, std::vector< double > samples );
+};
+
+// One human readable row.
+std::ostream &operator<<( std::ostream &out, const BenchmarkResult &result );
+
+void writeJsonLine( std::ostream &out, const BenchmarkResult &result );
+// Reads what writeJsonLine wrote. Lines without a name and median are skipped.
+std::vector< BenchmarkResult > readJsonLines( std::istream &in );
+
+// Compares medians against the baseline, one line per benchmark. Returns how many got slower
+// by more than threshold, a fraction (0.1 is 10%).
+unsigned compareToBaseline( const std::vector< BenchmarkResult > &results, const std::vector< BenchmarkResult > &baseline,
+	double threshold, std::ostream &out );
+
+class BenchmarkRunner
+{
+public:
+	explicit BenchmarkRunner( BenchmarkOptions options = {} );
+
+	void add( std::string name, BenchmarkSetup setup );
+	std::vector< std::string > names() const;
+
+	// Runs every benchmark matching the filter, in the order added, passing each result to
+	// report as soon as it's done.
+	std::vector< BenchmarkResult > run( const std::function< void( const BenchmarkResult & ) > &report ) const;
+
+private:
+	BenchmarkOptions mOptions;
+	std::vector< std::pair< std::string, BenchmarkSetup > > mBenchmarks;
+};
+
+// Somewhere to put results nobody reads, so the compiler can't optimise the work away.
+inline volatile std::uint64_t benchmark_sink = 0;
+
+inline void consume( std::uint64_t value )
+{
+	benchmark_sink = value;
+}
+
+#endif
@@ -0,0 +1,516 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../InterviewProgrammingQuestions/Algorithms.h"
+#include "../InterviewProgrammingQuestions/FleetPlacement.h"
+#include "../InterviewProgrammingQuestions/GameLog.h"
+#include "../InterviewProgrammingQuestions/Instrumentation.h"
+#include "../InterviewProgrammingQuestions/Random.h"
+#include "../InterviewProgrammingQuestions/ShipIndex.h"
+#include "../InterviewProgrammingQuestions/ShipMap.h"
+#include "../InterviewProgrammingQuestions/Simulator.h"
+#include "../InterviewProgrammingQuestions/Targeting.h"
+
+// Benchmarks for the questions and the board code. Builds against everything in
+// InterviewProgrammingQuestions except its main().
+//
+//   Benchmarks [--filter text] [--json] [--save file] [--compare file [--threshold percent]]
+//              [--repetitions n] [--warmup n] [--min-time seconds] [--list]
+//
+// --json prints one JSON object per benchmark instead of the table; --save writes the same
+// to a file, which --compare reads back as the baseline. Comparing exits with 1 if any median
+// got slower than the threshold allows (10% unless given).
+
+using namespace std;
+
+namespace
+{
+	// Question 1: one calcSum call per iteration.
+	void addSumBenchmarks( BenchmarkRunner &runner )
+	{
+		for( size_t size : { 16u, 1024u, 65536u, 1048576u } )
+		{
+			runner.add( "sum/" + to_string( size ), [size]()
+			{
+				auto values = make_shared< vector< int > >( size );
+				SplitMix64 rng{ size };
+				for( auto &value : *values )
+					value = static_cast< int >( rng.below( 1000 ) );
+				return [values]( uint64_t iterations )
+				{
+					uint64_t total = 0;
+					for( uint64_t i = 0; i < iterations; ++i )
+						total += static_cast< unsigned >( calcSum( *values ) );
+					consume( total );
+				};
+			} );
+		}
+	}
+
+	string nodeName( unsigned node )
+	{
+		return "node" + to_string( node );
+	}
+
+	// Dependency graphs of a few shapes: a chain and a tree have no cycles, a ring is one big
+	// cycle, and random gives every node a few dependencies anywhere in the graph.
+	Dictionary buildGraph( const string &shape, unsigned nodes )
+	{
+		Dictionary dict;
+		SplitMix64 rng{ nodes };
+		for( unsigned node = 0; node < nodes; ++node )
+		{
+			auto &deps = dict[ nodeName( node ) ];
+			if( shape == "chain" && node + 1 < nodes )
+				deps.push_back( nodeName( node + 1 ) );
+			else if( shape == "ring" )
+				deps.push_back( nodeName( ( node + 1 ) % nodes ) );
+			else if( shape == "tree" )
+			{
+				for( unsigned child : { 2 * node + 1, 2 * node + 2 } )
+				{
+					if( child < nodes )
+						deps.push_back( nodeName( child ) );
+				}
+			}
+			else if( shape == "random" )
+			{
+				for( unsigned i = 0; i < 3; ++i )
+					deps.push_back( nodeName( rng.below( nodes ) ) );
+			}
+		}
+		return dict;
+	}
+
+	// Question 2: one getCircularDependencies call per iteration.
+	void addCycleBenchmarks( BenchmarkRunner &runner )
+	{
+		for( const char *shape : { "chain", "ring", "tree", "random" } )
+		{
+			for( unsigned nodes : { 16u, 64u, 256u } )
+			{
+				runner.add( string( "cycles/" ) + shape + "/" + to_string( nodes ), [shape, nodes]()
+				{
+					auto dict = make_shared< Dictionary >( buildGraph( shape, nodes ) );
+					return [dict]( uint64_t iterations )
+					{
+						uint64_t found = 0;
+						for( uint64_t i = 0; i < iterations; ++i )
+							found += getCircularDependencies( *dict ).size();
+						consume( found );
+					};
+				} );
+			}
+		}
+	}
+
+	// Shots and placements on the standard board, then the parts that take any board size.
+	void addBoardBenchmarks( BenchmarkRunner &runner )
+	{
+		// One checkShot per iteration, playing games through in a fixed random order and
+		// starting again from a copy of the placed fleet.
+		runner.add( "board/" + to_string( MAP_SIZE ) + "/shot", []()
+		{
+			auto original = make_shared< Map >();
+			SplitMix64 rng{ 1 };
+			FleetPlacer().place( *original, rng );
+			auto order = make_shared< vector< Point2D > >();
+			for( unsigned cell = 0; cell < BoardMask::CELLS; ++cell )
+				order->push_back( BoardMask::point( cell ) );
+			for( size_t i = order->size() - 1; i > 0; --i )
+				swap( ( *order )[ i ], ( *order )[ rng.below( static_cast< unsigned >( i + 1 ) ) ] );
+
+			return [original, order]( uint64_t iterations )
+			{
+				Map map = *original;
+				size_t next = 0;
+				uint64_t hits = 0;
+				for( uint64_t i = 0; i < iterations; ++i )
+				{
+					if( next == order->size() )
+					{
+						map = *original;
+						next = 0;
+					}
+					hits += get< HitType >( map.checkShot( ( *order )[ next++ ] ) ) != HitType::MISS;
+				}
+				consume( hits );
+			};
+		} );
+
+		// One standard fleet placed per iteration.
+		runner.add( "board/" + to_string( MAP_SIZE ) + "/place-masks", []()
+		{
+			auto placer = make_shared< FleetPlacer >();
+			return [placer]( uint64_t iterations )
+			{
+				Map map;
+				SplitMix64 rng{ 7 };
+				for( uint64_t i = 0; i < iterations; ++i )
+				{
+					map.clear();
+					placer->place( map, rng );
+				}
+				consume( map.getShips().size() );
+			};
+		} );
+		runner.add( "board/" + to_string( MAP_SIZE ) + "/place-retry", []()
+		{
+			return []( uint64_t iterations )
+			{
+				Map map;
+				SplitMix64 rng{ 7 };
+				for( uint64_t i = 0; i < iterations; ++i )
+				{
+					map.clear();
+					placeFleetByRetry( map, rng );
+				}
+				consume( map.getShips().size() );
+			};
+		} );
+
+		// 42 of the 100 points taken; this is where retrying addShip starts to struggle.
+		static constexpr FleetEntry crowded[] =
+		{
+			{ "A", 5 }, { "B", 5 }, { "C", 4 }, { "D", 4 }, { "E", 4 }, { "F", 3 }, { "G", 3 },
+			{ "H", 3 }, { "I", 3 }, { "J", 2 }, { "K", 2 }, { "L", 2 }, { "M", 2 }
+		};
+		runner.add( "board/" + to_string( MAP_SIZE ) + "/place-masks-crowded", []()
+		{
+			auto placer = make_shared< FleetPlacer >( crowded );
+			return [placer]( uint64_t iterations )
+			{
+				Map map;
+				SplitMix64 rng{ 7 };
+				for( uint64_t i = 0; i < iterations; ++i )
+				{
+					map.clear();
+					placer->place( map, rng );
+				}
+				consume( map.getShips().size() );
+			};
+		} );
+		runner.add( "board/" + to_string( MAP_SIZE ) + "/place-retry-crowded", []()
+		{
+			return []( uint64_t iterations )
+			{
+				Map map;
+				SplitMix64 rng{ 7 };
+				for( uint64_t i = 0; i < iterations; ++i )
+				{
+					map.clear();
+					placeFleetByRetry( map, rng, crowded );
+				}
+				consume( map.getShips().size() );
+			};
+		} );
+
+		// Map is fixed at MAP_SIZE, so larger boards go through the ship index and the
+		// targeting engine directly. One lookup per iteration, half of them on a ship.
+		for( unsigned board : { 1000u, 100000u, 1000000u } )
+		{
+			runner.add( "board/" + to_string( board ) + "/index-lookup", [board]()
+			{
+				constexpr unsigned SHIPS = 10000;
+				unsigned lines = min( board, 2000u );
+				SplitMix64 rng{ board };
+				auto index = make_shared< ShipIndex >();
+				vector< Ship > ships;
+				while( ships.size() < SHIPS )
+				{
+					unsigned span = 1 + rng.below( 4 );
+					bool horizontal = rng.below( 2 ) == 0;
+					unsigned line = rng.below( lines ) * ( board / lines );
+					unsigned along = rng.below( board - span );
+					Point2D start = horizontal ? Point2D{ along, line } : Point2D{ line, along };
+					Point2D end = horizontal ? Point2D{ along + span, line } : Point2D{ line, along + span };
+					Ship ship( start, end, "" );
+					if( index->insert( ship, static_cast< uint32_t >( ships.size() ) ) )
+						ships.push_back( ship );
+				}
+
+				auto queries = make_shared< vector< Point2D > >();
+				for( unsigned i = 0; i < 4096; ++i )
+				{
+					const auto &ship = ships[ rng.below( SHIPS ) ];
+					queries->push_back( i % 2 ? ship.getStart() : Point2D{ rng.below( board ), ship.getStart().y } );
+				}
+
+				return [index, queries]( uint64_t iterations )
+				{
+					uint64_t found = 0;
+					for( uint64_t i = 0; i < iterations; ++i )
+						found += index->find( ( *queries )[ i % queries->size() ] ) != ShipIndex::NO_SHIP;
+					consume( found );
+				};
+			} );
+		}
+
+		// One bestShot per iteration, on a board with a tenth of it missed and one hit. The
+		// largest board runs again with a thread per core (threads 0 here).
+		struct BestShotCase
+		{
+			unsigned board;
+			unsigned threads;
+		};
+		for( auto [board, threads] : { BestShotCase{ 10, 1 }, BestShotCase{ 100, 1 }, BestShotCase{ 1000, 1 }, BestShotCase{ 1000, 0 } } )
+		{
+			string suffix = threads ? "" : "-threads";
+			runner.add( "board/" + to_string( board ) + "/best-shot" + suffix, [board, threads]()
+			{
+				auto view = make_shared< BoardView >( board, board );
+				view->remaining = { 5, 4, 3, 3, 2 };
+				SplitMix64 rng{ board };
+				for( auto &cell : view->cells )
+					cell = ( rng.below( 10 ) == 0 ) ? CellView::MISS : CellView::UNKNOWN;
+				view->at( { board / 2, board / 2 } ) = CellView::HIT;
+				auto engine = make_shared< TargetingEngine >( threads ? threads : max( 1u, thread::hardware_concurrency() ) );
+
+				return [view, engine]( uint64_t iterations )
+				{
+					uint64_t total = 0;
+					for( uint64_t i = 0; i < iterations; ++i )
+						total += engine->bestShot( *view ).x;
+					consume( total );
+				};
+			} );
+		}
+	}
+
+	// Exhaustive search to a fixed depth, cloning the map at every node. Returns the nodes visited.
+	size_t searchNodes( const Map &map, unsigned depth )
+	{
+		if( depth == 0 )
+			return 1;
+
+		size_t nodes = 1;
+		for( Point2D shot : map.unpicked() )
+		{
+			Map child = map;
+			child.checkShot( shot );
+			nodes += searchNodes( child, depth - 1 );
+		}
+		return nodes;
+	}
+
+	// Whole games: rebuilding them from the log, playing them out, and searching them.
+	void addGameBenchmarks( BenchmarkRunner &runner )
+	{
+		// One replay per iteration of a placed fleet shot at every point in a random order:
+		// 105 events, with a snapshot every 16.
+		auto makeLog = []()
+		{
+			auto log = make_shared< GameLog >( 16 );
+			Map placed, live;
+			SplitMix64 rng{ 5 };
+			FleetPlacer().place( placed, rng );
+			for( const auto &ship : placed.getShips() )
+				log->addShip( live, ship );
+			vector< Point2D > order;
+			for( unsigned cell = 0; cell < BoardMask::CELLS; ++cell )
+				order.push_back( BoardMask::point( cell ) );
+			for( size_t i = order.size() - 1; i > 0; --i )
+				swap( order[ i ], order[ rng.below( static_cast< unsigned >( i + 1 ) ) ] );
+			for( Point2D shot : order )
+				log->checkShot( live, shot );
+			return log;
+		};
+		runner.add( "log/replay", [makeLog]()
+		{
+			auto log = makeLog();
+			return [log]( uint64_t iterations )
+			{
+				uint64_t picked = 0;
+				for( uint64_t i = 0; i < iterations; ++i )
+					picked += log->replay().pickedCount();
+				consume( picked );
+			};
+		} );
+		runner.add( "log/replay-from-start", [makeLog]()
+		{
+			auto log = makeLog();
+			return [log]( uint64_t iterations )
+			{
+				uint64_t picked = 0;
+				for( uint64_t i = 0; i < iterations; ++i )
+					picked += log->replayFromStart().pickedCount();
+				consume( picked );
+			};
+		} );
+
+		// One game per iteration, on one thread.
+		auto addSimulation = [&runner]( const string &name, ShotPolicyFactory make_policy )
+		{
+			runner.add( "sim/" + name, [make_policy]()
+			{
+				return [make_policy]( uint64_t iterations )
+				{
+					SimulationConfig config;
+					config.games = iterations;
+					config.seed = 42;
+					consume( runSimulation( config, make_policy ).unfinished );
+				};
+			} );
+		};
+		addSimulation( "random", []() { return make_unique< RandomShotPolicy >(); } );
+		addSimulation( "hunt-target", []() { return make_unique< HuntTargetShotPolicy >(); } );
+		addSimulation( "density", []() { return make_unique< DensityShotPolicy >(); } );
+
+		// One copy of a placed map, and a shot on the copy, per iteration.
+		runner.add( "map/clone-shot", []()
+		{
+			auto original = make_shared< Map >();
+			SplitMix64 rng{ 11 };
+			FleetPlacer().place( *original, rng );
+			return [original]( uint64_t iterations )
+			{
+				uint64_t picked = 0;
+				for( uint64_t i = 0; i < iterations; ++i )
+				{
+					Map copy = *original;
+					copy.checkShot( BoardMask::point( static_cast< unsigned >( i % BoardMask::CELLS ) ) );
+					picked += copy.pickedCount();
+				}
+				consume( picked );
+			};
+		} );
+
+		// One whole search per iteration; depth 3 from an unshot board visits 980,201 nodes.
+		for( unsigned depth : { 2u, 3u } )
+		{
+			runner.add( "map/search-depth" + to_string( depth ), [depth]()
+			{
+				auto original = make_shared< Map >();
+				SplitMix64 rng{ 11 };
+				FleetPlacer().place( *original, rng );
+				return [original, depth]( uint64_t iterations )
+				{
+					uint64_t nodes = 0;
+					for( uint64_t i = 0; i < iterations; ++i )
+						nodes += searchNodes( *original, depth );
+					consume( nodes );
+				};
+			} );
+		}
+	}
+
+	int usage()
+	{
+		cerr << "Usage: Benchmarks [--filter text] [--json] [--save file] [--compare file [--threshold percent]]" << endl
+			<< "                  [--repetitions n] [--warmup n] [--min-time seconds] [--list]" << endl;
+		return 2;
+	}
+}
+
+int main( int argc, char *argv[] )
+{
+	BenchmarkOptions options;
+	bool json = false;
+	bool list = false;
+	string save_path;
+	string compare_path;
+	double threshold = 10.0;
+
+	try
+	{
+		for( int i = 1; i < argc; ++i )
+		{
+			string arg = argv[ i ];
+			bool has_value = i + 1 < argc;
+			if( arg == "--json" )
+				json = true;
+			else if( arg == "--list" )
+				list = true;
+			else if( arg == "--filter" && has_value )
+				options.filter = argv[ ++i ];
+			else if( arg == "--save" && has_value )
+				save_path = argv[ ++i ];
+			else if( arg == "--compare" && has_value )
+				compare_path = argv[ ++i ];
+			else if( arg == "--threshold" && has_value )
+				threshold = stod( argv[ ++i ] );
+			else if( arg == "--repetitions" && has_value )
+				options.repetitions = static_cast< unsigned >( stoul( argv[ ++i ] ) );
+			else if( arg == "--warmup" && has_value )
+				options.warmup = static_cast< unsigned >( stoul( argv[ ++i ] ) );
+			else if( arg == "--min-time" && has_value )
+				options.min_repetition_seconds = stod( argv[ ++i ] );
+			else
+				return usage();
+		}
+	}
+	catch( std::exception & )
+	{
+		return usage();
+	}
+
+	BenchmarkRunner runner( options );
+	addSumBenchmarks( runner );
+	addCycleBenchmarks( runner );
+	addBoardBenchmarks( runner );
+	addGameBenchmarks( runner );
+
+	if( list )
+	{
+		for( const auto &name : runner.names() )
+			cout << name << endl;
+		return 0;
+	}
+
+	// Read the baseline first, so a bad path fails before spending minutes benchmarking.
+	vector< BenchmarkResult > baseline;
+	if( !compare_path.empty() )
+	{
+		ifstream in( compare_path );
+		baseline = readJsonLines( in );
+		if( baseline.empty() )
+		{
+			cerr << "No benchmark results in " << compare_path << endl;
+			return 2;
+		}
+	}
+
+	if( instrumentation::enabled() )
+		cerr << "Warning: built with ENABLE_INSTRUMENTATION, so the timings include the probes." << endl;
+
+	auto results = runner.run( [json]( const BenchmarkResult &result )
+	{
+		if( json )
+			writeJsonLine( cout, result );
+		else
+			cout << result << endl;
+	} );
+
+	if( !save_path.empty() )
+	{
+		ofstream out( save_path );
+		for( const auto &result : results )
+			writeJsonLine( out, result );
+		if( !out )
+		{
+			cerr << "Couldn't write " << save_path << endl;
+			return 2;
+		}
+	}
+
+	if( !baseline.empty() )
+	{
+		// Keep stdout pure JSON lines when asked for them.
+		auto &out = json ? cerr : cout;
+		out << endl << "Compared with " << compare_path << " (threshold " << threshold << "%):" << endl;
+		unsigned regressions = compareToBaseline( results, baseline, threshold / 100.0, out );
+		if( regressions )
+		{
+			out << regressions << " benchmark(s) regressed." << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
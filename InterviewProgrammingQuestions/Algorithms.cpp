@@ -0,0 +1,64 @@
+#include "Algorithms.h"
+#include "Instrumentation.h"
+
+#include <algorithm>
+
+using namespace std;
+
+int calcSum( std::span< int > vals )
+{
+	INSTRUMENT_SCOPE( "calcSum" );
+	INSTRUMENT_RECORD( "calcSum elements", vals.size() );
+	int sum = 0;
+	for( const auto &val : vals )
+		sum += val;
+	return sum;
+}
+
+bool track_cycle( const Dictionary &dict, const string &start_key, const list< string > &dependencies, set< string > &cyclical_nodes, set< string > &traversed_keys )
+{
+	INSTRUMENT_DEPTH( "track_cycle depth" );
+	INSTRUMENT_COUNT( "track_cycle nodes visited", 1 );
+	if( std::find( dependencies.begin(), dependencies.end(), start_key ) != dependencies.end() )
+	{
+		cyclical_nodes.insert( start_key );
+		return true;
+	}
+
+	bool cycle = false;
+	for( const auto &dep : dependencies )
+	{
+		if( !dict.contains( dep ) )
+			continue;
+		if( traversed_keys.contains( dep ) )
+		{
+			cyclical_nodes.insert( dep );
+			cyclical_nodes.insert( start_key );
+			return true;
+		}
+		auto new_deps = dict.at( dep );
+		// Tracking the keys here breaks infinite loops where the start key isn't directly involved in the loop.
+		traversed_keys.insert( dep );
+		cycle |= track_cycle( dict, start_key, new_deps, cyclical_nodes, traversed_keys );
+	}
+	traversed_keys.insert( start_key );
+	return cycle;
+}
+
+set< string > getCircularDependencies( Dictionary dict )
+{
+	INSTRUMENT_SCOPE( "getCircularDependencies" );
+	set< string > circular_nodes;
+
+	for( const auto &[ key, deps ] : dict )
+	{
+		if( circular_nodes.contains( key ) )
+			continue;
+		// could increase efficiency by putting this outside the loop and skipping keys that have been traversed
+		// as part of other keys
+		set< string > traversed_keys;
+		track_cycle( dict, key, deps, circular_nodes, traversed_keys );
+	}
+
+	return circular_nodes;
+}
@@ -0,0 +1,24 @@
+#ifndef ALGORITHMS_H
+#define ALGORITHMS_H
+
+#include <list>
+#include <map>
+#include <set>
+#include <span>
+#include <string>
+
+// The answers to the first two questions, shared by the tests and the benchmarks.
+
+int calcSum( std::span< int > vals );
+
+using Dictionary = std::map< std::string, std::list< std::string > >;
+
+// Recursive function that returns true if a cycle was encountered. Uses lots of references in order to track things; this could
+// be simplified by making this part of a class that saved that data instead. 
+bool track_cycle( const Dictionary &dict, const std::string &start_key, const std::list< std::string > &dependencies,
+	std::set< std::string > &cyclical_nodes, std::set< std::string > &traversed_keys );
+
+/// Returns an ordered set of all nodes involved in circular references. 
+std::set< std::string > getCircularDependencies( Dictionary dict );
+
+#endif
@@ -0,0 +1,140 @@
+#include "FleetPlacement.h"
+
+#include <algorithm>
+
+namespace
+{
+	// A dead end (some ship with nowhere left to go) means starting the fleet over; give up after this many.
+	constexpr unsigned MAX_RESTARTS = 100;
+
+	// Random picks tried before falling back to counting every placement that fits.
+	constexpr unsigned MAX_QUICK_PICKS = 16;
+
+	// Two orientations of at most every point on the board.
+	constexpr unsigned MAX_PLACEMENTS = 2 * MAP_SIZE * MAP_SIZE;
+}
+
+PlacementTable::PlacementTable( unsigned length ) : mLength{ length }
+{
+	if( length == 0 || length > MAP_SIZE )
+		return;
+
+	unsigned span = length - 1;
+	for( unsigned horizontal = 0; horizontal < 2; ++horizontal )
+	{
+		// A one point ship is the same either way round.
+		if( !horizontal && length == 1 )
+			continue;
+		for( unsigned y = 0; y < MAP_SIZE - ( horizontal ? 0 : span ); ++y )
+		{
+			for( unsigned x = 0; x < MAP_SIZE - ( horizontal ? span : 0 ); ++x )
+			{
+				Placement placement;
+				placement.start = { x, y };
+				placement.end = horizontal ? Point2D{ x + span, y } : Point2D{ x, y + span };
+				for( unsigned i = 0; i < length; ++i )
+					placement.mask.set( horizontal ? Point2D{ x + i, y } : Point2D{ x, y + i } );
+				mPlacements.push_back( placement );
+			}
+		}
+	}
+}
+
+const Placement *PlacementTable::sample( const BoardMask &occupied, SplitMix64 &rng ) const
+{
+	if( mPlacements.empty() )
+		return nullptr;
+
+	// While the board's mostly empty, a random placement nearly always fits, so try a few.
+	for( unsigned attempt = 0; attempt < MAX_QUICK_PICKS; ++attempt )
+	{
+		const auto &placement = mPlacements[ rng.below( static_cast< unsigned >( mPlacements.size() ) ) ];
+		if( !placement.mask.intersects( occupied ) )
+			return &placement;
+	}
+
+	// Crowded: collect everything that fits and pick one. Still uniform, since every
+	// placement that fits was equally likely to be missed by the quick picks.
+	std::array< std::uint16_t, MAX_PLACEMENTS > fits;
+	unsigned fit_count = 0;
+	for( unsigned i = 0; i < mPlacements.size(); ++i )
+	{
+		fits[ fit_count ] = static_cast< std::uint16_t >( i );
+		fit_count += mPlacements[ i ].mask.intersects( occupied ) ? 0u : 1u;
+	}
+	if( fit_count == 0 )
+		return nullptr;
+	return &mPlacements[ fits[ rng.below( fit_count ) ] ];
+}
+
+FleetPlacer::FleetPlacer( std::span< const FleetEntry > fleet ) : mFleet( fleet.begin(), fleet.end() )
+{
+	for( const auto &entry : mFleet )
+	{
+		auto found = std::find_if( mTables.begin(), mTables.end(), [&entry]( const PlacementTable &table ) { return table.length() == entry.length; } );
+		if( found == mTables.end() )
+		{
+			mTables.emplace_back( entry.length );
+			found = mTables.end() - 1;
+		}
+		mTableFor.push_back( static_cast< unsigned >( found - mTables.begin() ) );
+	}
+}
+
+bool FleetPlacer::place( Map &map, SplitMix64 &rng ) const
+{
+	// Pick the whole fleet before touching the map, so a dead end just starts over
+	// without having to take ships back off it.
+	std::vector< const Placement * > chosen( mFleet.size() );
+	for( unsigned restart = 0; restart < MAX_RESTARTS; ++restart )
+	{
+		BoardMask occupied = map.getOccupied();
+		bool placed = true;
+		for( size_t i = 0; i < mFleet.size() && placed; ++i )
+		{
+			chosen[ i ] = mTables[ mTableFor[ i ] ].sample( occupied, rng );
+			placed = chosen[ i ] != nullptr;
+			if( placed )
+				occupied |= chosen[ i ]->mask;
+		}
+		if( !placed )
+			continue;
+
+		// The table's placements are on the board and sampled clear of everything already
+		// there, so there's nothing for addShip to check.
+		for( size_t i = 0; i < mFleet.size(); ++i )
+			map.addPlacedShip( Ship( chosen[ i ]->start, chosen[ i ]->end, mFleet[ i ].name ), chosen[ i ]->mask );
+		return true;
+	}
+	return false;
+}
+
+void placeFleetByRetry( Map &map, SplitMix64 &rng, std::span< const FleetEntry > fleet )
+{
+	// Retry each ship until it fits; on the off chance the board's too crowded, start over.
+	constexpr unsigned MAX_ATTEMPTS = 1000;
+	bool placed = false;
+	while( !placed )
+	{
+		placed = true;
+		for( const auto &entry : fleet )
+		{
+			unsigned attempts = 0;
+			bool added = false;
+			while( !added && attempts++ < MAX_ATTEMPTS )
+			{
+				bool horizontal = rng.below( 2 ) == 0;
+				unsigned span = entry.length - 1;
+				Point2D start = { rng.below( MAP_SIZE - ( horizontal ? span : 0 ) ), rng.below( MAP_SIZE - ( horizontal ? 0 : span ) ) };
+				Point2D end = horizontal ? Point2D{ start.x + span, start.y } : Point2D{ start.x, start.y + span };
+				added = map.addShip( Ship( start, end, entry.name ) );
+			}
+			if( !added )
+			{
+				map.clear();
+				placed = false;
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef FLEET_PLACEMENT_H
+#define FLEET_PLACEMENT_H
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include "ShipMap.h"
+#include "Random.h"
+
+// Random fleet placement from precomputed placement masks. Every legal position of a
+// ship of a given length is worked out once; placing a fleet is then, for each ship,
+// a uniform pick among the positions that miss everything placed so far. No retrying
+// addShip, so crowded boards cost no more than empty ones.
+
+struct FleetEntry
+{
+	const char *name;
+	unsigned length;
+};
+
+// Names are short enough for the small string buffer, so building the ships doesn't allocate.
+constexpr std::array< FleetEntry, 5 > STANDARD_FLEET =
+{ {
+	{ "Carrier", 5 },
+	{ "Battleship", 4 },
+	{ "Cruiser", 3 },
+	{ "Submarine", 3 },
+	{ "Destroyer", 2 }
+} };
+
+struct Placement
+{
+	BoardMask mask;
+	Point2D start;
+	Point2D end;
+};
+
+// Every legal placement of one ship length on the board.
+class PlacementTable
+{
+public:
+	explicit PlacementTable( unsigned length );
+
+	unsigned length() const { return mLength; }
+	const std::vector< Placement > &getPlacements() const { return mPlacements; }
+
+	// Uniformly picks one of the placements that don't intersect occupied.
+	// Returns nullptr if none of them fit.
+	const Placement *sample( const BoardMask &occupied, SplitMix64 &rng ) const;
+
+private:
+	unsigned mLength;
+	std::vector< Placement > mPlacements;
+};
+
+class FleetPlacer
+{
+public:
+	explicit FleetPlacer( std::span< const FleetEntry > fleet = STANDARD_FLEET );
+
+	// Adds the whole fleet to the map, around any ships already on it. Returns false
+	// (leaving the map as it was) if the fleet can't fit.
+	bool place( Map &map, SplitMix64 &rng ) const;
+
+private:
+	std::vector< FleetEntry > mFleet;
+	// One table per distinct length, and which table each fleet entry uses.
+	std::vector< PlacementTable > mTables;
+	std::vector< unsigned > mTableFor;
+};
+
+// The straightforward way: random ship positions, retrying addShip until each one fits.
+// Kept as the reference the placement tables are measured against.
+void placeFleetByRetry( Map &map, SplitMix64 &rng, std::span< const FleetEntry > fleet = STANDARD_FLEET );
+
+#endif
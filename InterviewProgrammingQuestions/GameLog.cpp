@@ -0,0 +1,335 @@
+#include "GameLog.h"
+
+#include <algorithm>
+
+namespace
+{
+	// "BSLG", then a format version. Bump the version if the layout changes.
+	// 2: snapshots store the picked points in BoardMask's (row-major) order.
+	constexpr std::uint32_t LOG_MAGIC = 0x474C5342u;
+	constexpr std::uint32_t LOG_VERSION = 2u;
+
+	// Everything is written little-endian regardless of the host, so logs are portable.
+	void writeU8( std::ostream &out, std::uint8_t value )
+	{
+		out.put( static_cast< char >( value ) );
+	}
+
+	void writeU32( std::ostream &out, std::uint32_t value )
+	{
+		char bytes[ 4 ];
+		for( unsigned i = 0; i < 4; ++i )
+			bytes[ i ] = static_cast< char >( ( value >> ( 8 * i ) ) & 0xFFu );
+		out.write( bytes, 4 );
+	}
+
+	void writeU64( std::ostream &out, std::uint64_t value )
+	{
+		writeU32( out, static_cast< std::uint32_t >( value ) );
+		writeU32( out, static_cast< std::uint32_t >( value >> 32 ) );
+	}
+
+	bool readU8( std::istream &in, std::uint8_t &value )
+	{
+		char byte;
+		if( !in.get( byte ) )
+			return false;
+		value = static_cast< std::uint8_t >( byte );
+		return true;
+	}
+
+	bool readU32( std::istream &in, std::uint32_t &value )
+	{
+		unsigned char bytes[ 4 ];
+		if( !in.read( reinterpret_cast< char * >( bytes ), 4 ) )
+			return false;
+		value = 0;
+		for( unsigned i = 0; i < 4; ++i )
+			value |= static_cast< std::uint32_t >( bytes[ i ] ) << ( 8 * i );
+		return true;
+	}
+
+	bool readU64( std::istream &in, std::uint64_t &value )
+	{
+		std::uint32_t low, high;
+		if( !readU32( in, low ) || !readU32( in, high ) )
+			return false;
+		value = ( static_cast< std::uint64_t >( high ) << 32 ) | low;
+		return true;
+	}
+
+	// Reads length bytes a chunk at a time, so a corrupt length fails at the end of the
+	// stream instead of allocating whatever it claims up front.
+	bool readString( std::istream &in, std::uint32_t length, std::string &value )
+	{
+		constexpr std::uint32_t CHUNK = 4096;
+		value.clear();
+		while( length > 0 )
+		{
+			std::uint32_t chunk = std::min( length, CHUNK );
+			auto offset = value.size();
+			value.resize( offset + chunk );
+			if( !in.read( value.data() + offset, chunk ) )
+				return false;
+			length -= chunk;
+		}
+		return true;
+	}
+
+	bool onBoard( Point2D point )
+	{
+		return point.x < MAP_SIZE && point.y < MAP_SIZE;
+	}
+}
+
+GameLog::GameLog( unsigned snapshot_interval ) : mSnapshotInterval{ snapshot_interval }
+{
+}
+
+bool GameLog::addShip( Map &map, const Ship &ship )
+{
+	if( !map.addShip( ship ) )
+		return false;
+
+	GameEvent event;
+	event.type = EventType::ADD_SHIP;
+	event.start = ship.getStart();
+	event.end = ship.getEnd();
+	event.name = static_cast< std::uint32_t >( mNames.size() );
+	mNames.push_back( ship.getName() );
+	mShipEvents.push_back( static_cast< std::uint32_t >( mEvents.size() ) );
+	append( map, event );
+	return true;
+}
+
+std::tuple< HitType, std::string > GameLog::checkShot( Map &map, Point2D coords )
+{
+	auto result = map.checkShot( coords );
+
+	GameEvent event;
+	event.type = EventType::SHOT;
+	event.result = std::get< HitType >( result );
+	event.start = coords;
+	append( map, event );
+	return result;
+}
+
+bool GameLog::undoLastShot( Map &map )
+{
+	if( mEvents.empty() || mEvents.back().type != EventType::SHOT )
+		return false;
+
+	const auto &event = mEvents.back();
+	// Repeats didn't change anything, so there's nothing to revert on the map.
+	if( event.result != HitType::REPEAT )
+		map.undoShot( event.start );
+	mEvents.pop_back();
+
+	// A snapshot taken after this shot no longer describes the board.
+	if( !mSnapshots.empty() && mSnapshots.back().event_count > mEvents.size() )
+		mSnapshots.pop_back();
+	return true;
+}
+
+Map GameLog::replay() const
+{
+	Map map;
+	BoardMask picked;
+	size_t first_event = 0;
+	if( !mSnapshots.empty() )
+	{
+		const auto &snapshot = mSnapshots.back();
+		for( auto ship_event : snapshot.ship_events )
+			placeShip( map, mEvents[ ship_event ] );
+		picked = snapshot.picked;
+		first_event = static_cast< size_t >( snapshot.event_count );
+	}
+
+	applyFrom( map, first_event, picked );
+	return map;
+}
+
+Map GameLog::replayFromStart() const
+{
+	Map map;
+	applyFrom( map, 0, {} );
+	return map;
+}
+
+void GameLog::write( std::ostream &out ) const
+{
+	writeU32( out, LOG_MAGIC );
+	writeU32( out, LOG_VERSION );
+	writeU32( out, mSnapshotInterval );
+
+	writeU32( out, static_cast< std::uint32_t >( mNames.size() ) );
+	for( const auto &name : mNames )
+	{
+		writeU32( out, static_cast< std::uint32_t >( name.size() ) );
+		out.write( name.data(), static_cast< std::streamsize >( name.size() ) );
+	}
+
+	writeU32( out, static_cast< std::uint32_t >( mEvents.size() ) );
+	for( const auto &event : mEvents )
+	{
+		writeU8( out, static_cast< std::uint8_t >( event.type ) );
+		writeU8( out, static_cast< std::uint8_t >( event.result ) );
+		writeU32( out, event.start.x );
+		writeU32( out, event.start.y );
+		writeU32( out, event.end.x );
+		writeU32( out, event.end.y );
+		writeU32( out, event.name );
+	}
+
+	writeU32( out, static_cast< std::uint32_t >( mSnapshots.size() ) );
+	for( const auto &snapshot : mSnapshots )
+	{
+		writeU64( out, snapshot.event_count );
+		writeU32( out, static_cast< std::uint32_t >( snapshot.ship_events.size() ) );
+		for( auto ship_event : snapshot.ship_events )
+			writeU32( out, ship_event );
+		for( auto word : snapshot.picked.words )
+			writeU64( out, word );
+	}
+}
+
+bool GameLog::read( std::istream &in )
+{
+	clear();
+
+	// Reads into the member containers directly; any failure clears them again.
+	auto fail = [this]()
+	{
+		clear();
+		return false;
+	};
+
+	std::uint32_t magic, version, count;
+	if( !readU32( in, magic ) || magic != LOG_MAGIC )
+		return fail();
+	if( !readU32( in, version ) || version != LOG_VERSION )
+		return fail();
+	if( !readU32( in, mSnapshotInterval ) )
+		return fail();
+
+	if( !readU32( in, count ) )
+		return fail();
+	for( std::uint32_t i = 0; i < count; ++i )
+	{
+		std::uint32_t length;
+		if( !readU32( in, length ) )
+			return fail();
+		std::string name;
+		if( !readString( in, length, name ) )
+			return fail();
+		mNames.push_back( std::move( name ) );
+	}
+
+	if( !readU32( in, count ) )
+		return fail();
+	// No reserve from the count: it hasn't been checked against the data yet.
+	for( std::uint32_t i = 0; i < count; ++i )
+	{
+		GameEvent event;
+		std::uint8_t type, result;
+		if( !readU8( in, type ) || !readU8( in, result ) ||
+			!readU32( in, event.start.x ) || !readU32( in, event.start.y ) ||
+			!readU32( in, event.end.x ) || !readU32( in, event.end.y ) ||
+			!readU32( in, event.name ) )
+		{
+			return fail();
+		}
+		if( type > static_cast< std::uint8_t >( EventType::SHOT ) ||
+			result > static_cast< std::uint8_t >( HitType::SUNK ) ||
+			!onBoard( event.start ) )
+		{
+			return fail();
+		}
+		event.type = static_cast< EventType >( type );
+		event.result = static_cast< HitType >( result );
+		if( event.type == EventType::ADD_SHIP )
+		{
+			if( !onBoard( event.end ) || event.name >= mNames.size() )
+				return fail();
+			mShipEvents.push_back( i );
+		}
+		mEvents.push_back( event );
+	}
+
+	if( !readU32( in, count ) )
+		return fail();
+	for( std::uint32_t i = 0; i < count; ++i )
+	{
+		Snapshot snapshot;
+		std::uint32_t ship_count;
+		if( !readU64( in, snapshot.event_count ) || snapshot.event_count > mEvents.size() ||
+			!readU32( in, ship_count ) || ship_count > mShipEvents.size() )
+		{
+			return fail();
+		}
+		snapshot.ship_events.resize( ship_count );
+		for( auto &ship_event : snapshot.ship_events )
+		{
+			if( !readU32( in, ship_event ) || ship_event >= snapshot.event_count ||
+				mEvents[ ship_event ].type != EventType::ADD_SHIP )
+			{
+				return fail();
+			}
+		}
+		for( auto &word : snapshot.picked.words )
+		{
+			if( !readU64( in, word ) )
+				return fail();
+		}
+		// Nothing may be set past the last point.
+		if( !BoardMask{}.complement().contains( snapshot.picked ) )
+			return fail();
+		mSnapshots.push_back( std::move( snapshot ) );
+	}
+
+	return true;
+}
+
+void GameLog::clear()
+{
+	mEvents.clear();
+	mNames.clear();
+	mShipEvents.clear();
+	mSnapshots.clear();
+}
+
+void GameLog::append( const Map &map, const GameEvent &event )
+{
+	mEvents.push_back( event );
+	if( mSnapshotInterval != 0 && mEvents.size() % mSnapshotInterval == 0 )
+		takeSnapshot( map );
+}
+
+void GameLog::takeSnapshot( const Map &map )
+{
+	Snapshot snapshot;
+	snapshot.event_count = mEvents.size();
+	snapshot.ship_events = mShipEvents;
+	snapshot.picked = map.getPicked();
+	mSnapshots.push_back( std::move( snapshot ) );
+}
+
+void GameLog::applyFrom( Map &map, size_t first_event, BoardMask picked ) const
+{
+	// The final board doesn't depend on the order the shots landed in, so add the ships and
+	// mark every shot at once. Ships' hits are just the picked points, so this sets them too.
+	for( size_t i = first_event; i < mEvents.size(); ++i )
+	{
+		const auto &event = mEvents[ i ];
+		if( event.type == EventType::ADD_SHIP )
+			placeShip( map, event );
+		else
+			picked.set( event.start );
+	}
+	map.setPicked( picked );
+}
+
+void GameLog::placeShip( Map &map, const GameEvent &event ) const
+{
+	map.addShip( Ship( event.start, event.end, mNames[ event.name ] ) );
+}
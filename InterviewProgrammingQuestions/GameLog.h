@@ -0,0 +1,93 @@
+#ifndef GAME_LOG_H
+#define GAME_LOG_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ShipMap.h"
+
+// Append-only log of everything that happened to a Map: ship placements and shots.
+// Used for auditing a game and for rebuilding the board after the fact.
+// Every so often a compact snapshot of the board is kept so replay doesn't have
+// to start from the first event.
+
+enum class EventType : unsigned char
+{
+	ADD_SHIP,
+	SHOT
+};
+
+// Fixed size so the log is a flat array, and undo is just a pop.
+struct GameEvent
+{
+	EventType type = EventType::SHOT;
+	// Only meaningful for shots; what checkShot returned at the time.
+	HitType result = HitType::MISS;
+	// Shot coordinates, or the ship's start point.
+	Point2D start;
+	// Ship end point, unused for shots.
+	Point2D end;
+	// Index into the log's name table, unused for shots.
+	std::uint32_t name = 0;
+};
+
+class GameLog
+{
+public:
+	// A snapshot is taken every snapshot_interval events; 0 disables snapshots.
+	explicit GameLog( unsigned snapshot_interval = 64 );
+
+	// Performs the action on the map and records it. Mirrors Map's API.
+	// Only successful placements are recorded, since failed ones don't change the board.
+	bool addShip( Map &map, const Ship &ship );
+	std::tuple< HitType, std::string > checkShot( Map &map, Point2D coords );
+
+	// Reverts the last event on the map and drops it from the log, if it was a shot.
+	// Returns false (and does nothing) otherwise.
+	bool undoLastShot( Map &map );
+
+	// Rebuilds the board from the most recent snapshot plus the events after it.
+	Map replay() const;
+
+	// Rebuilds the board from the first event, ignoring snapshots.
+	Map replayFromStart() const;
+
+	// Binary serialisation, events and snapshots both. read replaces the log contents,
+	// and returns false (leaving the log empty) if the data is truncated or invalid.
+	void write( std::ostream &out ) const;
+	bool read( std::istream &in );
+
+	const std::vector< GameEvent > &getEvents() const { return mEvents; }
+	const std::string &getName( const GameEvent &event ) const { return mNames[ event.name ]; }
+	size_t snapshotCount() const { return mSnapshots.size(); }
+	void clear();
+
+private:
+	// Compact board state: which events placed the current ships, plus the picked points.
+	// Ship hits are implied by the picked points, so they don't need storing.
+	struct Snapshot
+	{
+		std::uint64_t event_count = 0;
+		std::vector< std::uint32_t > ship_events;
+		BoardMask picked;
+	};
+
+	unsigned mSnapshotInterval;
+	std::vector< GameEvent > mEvents;
+	std::vector< std::string > mNames;
+	// Indices of every ADD_SHIP event; shots are the only thing undo removes, so this only grows.
+	std::vector< std::uint32_t > mShipEvents;
+	std::vector< Snapshot > mSnapshots;
+
+	void append( const Map &map, const GameEvent &event );
+	void takeSnapshot( const Map &map );
+	// Applies the events from first_event on, on top of the shots already in picked.
+	void applyFrom( Map &map, size_t first_event, BoardMask picked ) const;
+	void placeShip( Map &map, const GameEvent &event ) const;
+};
+
+#endif
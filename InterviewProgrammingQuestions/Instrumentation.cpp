@@ -0,0 +1,250 @@
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <mutex>
+
+#if defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#include <intrin.h>
+#define INSTRUMENT_HAS_RDTSC 1
+#elif defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define INSTRUMENT_HAS_RDTSC 1
+#endif
+
+namespace instrumentation
+{
+	namespace
+	{
+		struct ThreadStats;
+
+		// Probe names, and every thread that has touched a probe. Threads that have exited
+		// leave their numbers in retired so nothing is lost when workers finish.
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector< std::pair< std::string, ProbeKind > > probes;
+			std::vector< ThreadStats * > threads;
+			std::array< ProbeStats, MAX_PROBES > retired;
+		};
+
+		Registry &registry()
+		{
+			static Registry instance;
+			return instance;
+		}
+
+		struct ThreadStats
+		{
+			std::array< ProbeStats, MAX_PROBES > probes;
+			std::array< unsigned, MAX_PROBES > depths = {};
+
+			ThreadStats()
+			{
+				auto &shared = registry();
+				std::lock_guard< std::mutex > lock( shared.mutex );
+				shared.threads.push_back( this );
+			}
+
+			~ThreadStats()
+			{
+				auto &shared = registry();
+				std::lock_guard< std::mutex > lock( shared.mutex );
+				for( unsigned i = 0; i < MAX_PROBES; ++i )
+					shared.retired[ i ].merge( probes[ i ] );
+				shared.threads.erase( std::find( shared.threads.begin(), shared.threads.end(), this ) );
+			}
+		};
+
+		thread_local ThreadStats local_stats;
+
+		const char *kindName( ProbeKind kind )
+		{
+			switch( kind )
+			{
+			case ProbeKind::COUNTER: return "counter";
+			case ProbeKind::VALUE: return "value";
+			case ProbeKind::TIMER: return "timer";
+			case ProbeKind::DEPTH: return "depth";
+			}
+			return "unknown";
+		}
+
+		// Smallest and largest value that lands in a bucket.
+		std::uint64_t bucketLow( unsigned bucket )
+		{
+			return bucket == 0 ? 0 : std::uint64_t{ 1 } << ( bucket - 1 );
+		}
+
+		std::uint64_t bucketHigh( unsigned bucket )
+		{
+			return bucket == 0 ? 0 : ( bucket == 64 ? ~std::uint64_t{ 0 } : ( std::uint64_t{ 1 } << bucket ) - 1 );
+		}
+
+		void writeJsonString( std::ostream &out, const std::string &text )
+		{
+			out << '"';
+			for( char c : text )
+			{
+				if( c == '"' || c == '\\' )
+					out << '\\';
+				out << c;
+			}
+			out << '"';
+		}
+	}
+
+	void ProbeStats::merge( const ProbeStats &other )
+	{
+		count += other.count;
+		total += other.total;
+		min = std::min( min, other.min );
+		max = std::max( max, other.max );
+		for( unsigned i = 0; i < BUCKETS; ++i )
+			buckets[ i ] += other.buckets[ i ];
+	}
+
+	bool enabled()
+	{
+#ifdef ENABLE_INSTRUMENTATION
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	unsigned registerProbe( const char *name, ProbeKind kind )
+	{
+		auto &shared = registry();
+		std::lock_guard< std::mutex > lock( shared.mutex );
+		for( unsigned i = 0; i < shared.probes.size(); ++i )
+		{
+			if( shared.probes[ i ].first == name )
+				return i;
+		}
+
+		// Out of room: everything else shares the last slot.
+		if( shared.probes.size() == MAX_PROBES - 1 )
+			shared.probes.emplace_back( "(overflow)", kind );
+		if( shared.probes.size() == MAX_PROBES )
+			return MAX_PROBES - 1;
+
+		shared.probes.emplace_back( name, kind );
+		return static_cast< unsigned >( shared.probes.size() - 1 );
+	}
+
+	void add( unsigned probe, std::uint64_t amount )
+	{
+		auto &stats = local_stats.probes[ probe ];
+		++stats.count;
+		stats.total += amount;
+	}
+
+	void record( unsigned probe, std::uint64_t value )
+	{
+		auto &stats = local_stats.probes[ probe ];
+		++stats.count;
+		stats.total += value;
+		stats.min = std::min( stats.min, value );
+		stats.max = std::max( stats.max, value );
+		++stats.buckets[ std::bit_width( value ) ];
+	}
+
+	std::uint64_t ticks()
+	{
+#ifdef INSTRUMENT_HAS_RDTSC
+		return __rdtsc();
+#else
+		return static_cast< std::uint64_t >( std::chrono::steady_clock::now().time_since_epoch().count() );
+#endif
+	}
+
+	unsigned &depth( unsigned probe )
+	{
+		return local_stats.depths[ probe ];
+	}
+
+	std::vector< ProbeReport > collect()
+	{
+		auto &shared = registry();
+		std::lock_guard< std::mutex > lock( shared.mutex );
+
+		std::vector< ProbeReport > reports;
+		for( unsigned i = 0; i < shared.probes.size(); ++i )
+		{
+			ProbeReport report{ shared.probes[ i ].first, shared.probes[ i ].second, shared.retired[ i ] };
+			for( const auto *thread : shared.threads )
+				report.stats.merge( thread->probes[ i ] );
+			reports.push_back( std::move( report ) );
+		}
+		return reports;
+	}
+
+	void dumpText( std::ostream &out )
+	{
+		if( !enabled() )
+		{
+			out << "Instrumentation disabled (build with ENABLE_INSTRUMENTATION defined)." << std::endl;
+			return;
+		}
+
+		for( const auto &report : collect() )
+		{
+			const auto &stats = report.stats;
+			out << report.name << " (" << kindName( report.kind ) << "): count " << stats.count << ", total " << stats.total;
+			if( report.kind != ProbeKind::COUNTER && stats.count > 0 )
+			{
+				out << ", mean " << static_cast< double >( stats.total ) / stats.count
+					<< ", min " << stats.min << ", max " << stats.max;
+				if( report.kind == ProbeKind::TIMER )
+					out << " ticks";
+				out << std::endl << "    ";
+				for( unsigned b = 0; b < BUCKETS; ++b )
+				{
+					if( stats.buckets[ b ] )
+						out << " [" << bucketLow( b ) << "-" << bucketHigh( b ) << "]:" << stats.buckets[ b ];
+				}
+			}
+			out << std::endl;
+		}
+	}
+
+	void dumpJson( std::ostream &out )
+	{
+		out << "{\"enabled\": " << ( enabled() ? "true" : "false" ) << ", \"probes\": [";
+		bool first = true;
+		for( const auto &report : collect() )
+		{
+			const auto &stats = report.stats;
+			out << ( first ? "" : ", " ) << "{\"name\": ";
+			writeJsonString( out, report.name );
+			out << ", \"kind\": \"" << kindName( report.kind ) << "\", \"count\": " << stats.count << ", \"total\": " << stats.total;
+			if( report.kind != ProbeKind::COUNTER && stats.count > 0 )
+			{
+				out << ", \"min\": " << stats.min << ", \"max\": " << stats.max << ", \"buckets\": [";
+				bool first_bucket = true;
+				for( unsigned b = 0; b < BUCKETS; ++b )
+				{
+					if( !stats.buckets[ b ] )
+						continue;
+					out << ( first_bucket ? "" : ", " ) << "{\"low\": " << bucketLow( b ) << ", \"high\": " << bucketHigh( b ) << ", \"count\": " << stats.buckets[ b ] << "}";
+					first_bucket = false;
+				}
+				out << "]";
+			}
+			out << "}";
+			first = false;
+		}
+		out << "]}" << std::endl;
+	}
+
+	void reset()
+	{
+		auto &shared = registry();
+		std::lock_guard< std::mutex > lock( shared.mutex );
+		shared.retired = {};
+		for( auto *thread : shared.threads )
+			thread->probes = {};
+	}
+}
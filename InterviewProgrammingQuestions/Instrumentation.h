@@ -0,0 +1,132 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Hot path instrumentation: counters, values recorded into log2 histograms, and scoped
+// timers in TSC ticks. Everything is per thread, so a probe is a few plain increments
+// with no locking or atomics; dumping adds the threads together.
+//
+// Compiled out unless ENABLE_INSTRUMENTATION is defined (project-wide, so every file agrees).
+// Disabled, the macros expand to nothing and cost nothing; the dump functions still exist
+// and just say instrumentation is off, so callers don't need their own #ifdefs.
+//
+//   INSTRUMENT_COUNT( "name", amount );   adds to a counter
+//   INSTRUMENT_RECORD( "name", value );   records one value (sizes, depths, ...)
+//   INSTRUMENT_SCOPE( "name" );           times the rest of the enclosing scope
+//   INSTRUMENT_DEPTH( "name" );           records how deeply nested this scope is, for recursion
+//
+// Probes with the same name share statistics, wherever they are.
+
+namespace instrumentation
+{
+	constexpr unsigned MAX_PROBES = 32;
+	// Bucket b holds values v with bit_width( v ) == b, i.e. 0, 1, 2-3, 4-7, ...
+	constexpr unsigned BUCKETS = 65;
+
+	enum class ProbeKind : unsigned char
+	{
+		COUNTER,
+		VALUE,
+		TIMER,
+		DEPTH
+	};
+
+	struct ProbeStats
+	{
+		std::uint64_t count = 0;
+		std::uint64_t total = 0;
+		std::uint64_t min = ~std::uint64_t{ 0 };
+		std::uint64_t max = 0;
+		std::array< std::uint64_t, BUCKETS > buckets = {};
+
+		void merge( const ProbeStats &other );
+	};
+
+	// Everything known about one probe, summed over every thread.
+	struct ProbeReport
+	{
+		std::string name;
+		ProbeKind kind;
+		ProbeStats stats;
+	};
+
+	// Returns whether the probes were compiled in.
+	bool enabled();
+
+	// Adds up every thread's statistics. Reads other threads' counters without locking
+	// them, so call it while workers are idle (or accept slightly stale numbers).
+	std::vector< ProbeReport > collect();
+	void dumpText( std::ostream &out );
+	void dumpJson( std::ostream &out );
+	// Zeroes every thread's statistics; same caveat as collect.
+	void reset();
+
+	// Everything below is for the macros.
+	unsigned registerProbe( const char *name, ProbeKind kind );
+	void add( unsigned probe, std::uint64_t amount );
+	void record( unsigned probe, std::uint64_t value );
+	std::uint64_t ticks();
+	unsigned &depth( unsigned probe );
+
+	class ScopedTimer
+	{
+	public:
+		explicit ScopedTimer( unsigned probe ) : mProbe{ probe }, mStart{ ticks() } {}
+		~ScopedTimer() { record( mProbe, ticks() - mStart ); }
+
+		ScopedTimer( const ScopedTimer & ) = delete;
+		ScopedTimer &operator=( const ScopedTimer & ) = delete;
+
+	private:
+		unsigned mProbe;
+		std::uint64_t mStart;
+	};
+
+	class ScopedDepth
+	{
+	public:
+		explicit ScopedDepth( unsigned probe ) : mDepth{ depth( probe ) } { record( probe, ++mDepth ); }
+		~ScopedDepth() { --mDepth; }
+
+		ScopedDepth( const ScopedDepth & ) = delete;
+		ScopedDepth &operator=( const ScopedDepth & ) = delete;
+
+	private:
+		unsigned &mDepth;
+	};
+}
+
+#ifdef ENABLE_INSTRUMENTATION
+
+#define INSTRUMENT_CONCAT_( a, b ) a##b
+#define INSTRUMENT_CONCAT( a, b ) INSTRUMENT_CONCAT_( a, b )
+// Each probe site looks its id up once, the first time it runs.
+#define INSTRUMENT_PROBE_ID( name, kind ) \
+	static const unsigned INSTRUMENT_CONCAT( instrument_probe_, __LINE__ ) = instrumentation::registerProbe( name, instrumentation::ProbeKind::kind )
+
+#define INSTRUMENT_COUNT( name, amount ) \
+	do { INSTRUMENT_PROBE_ID( name, COUNTER ); instrumentation::add( INSTRUMENT_CONCAT( instrument_probe_, __LINE__ ), amount ); } while( false )
+#define INSTRUMENT_RECORD( name, value ) \
+	do { INSTRUMENT_PROBE_ID( name, VALUE ); instrumentation::record( INSTRUMENT_CONCAT( instrument_probe_, __LINE__ ), value ); } while( false )
+#define INSTRUMENT_SCOPE( name ) \
+	INSTRUMENT_PROBE_ID( name, TIMER ); \
+	instrumentation::ScopedTimer INSTRUMENT_CONCAT( instrument_timer_, __LINE__ )( INSTRUMENT_CONCAT( instrument_probe_, __LINE__ ) )
+#define INSTRUMENT_DEPTH( name ) \
+	INSTRUMENT_PROBE_ID( name, DEPTH ); \
+	instrumentation::ScopedDepth INSTRUMENT_CONCAT( instrument_depth_, __LINE__ )( INSTRUMENT_CONCAT( instrument_probe_, __LINE__ ) )
+
+#else
+
+#define INSTRUMENT_COUNT( name, amount ) ( (void)0 )
+#define INSTRUMENT_RECORD( name, value ) ( (void)0 )
+#define INSTRUMENT_SCOPE( name ) ( (void)0 )
+#define INSTRUMENT_DEPTH( name ) ( (void)0 )
+
+#endif
+
+#endif
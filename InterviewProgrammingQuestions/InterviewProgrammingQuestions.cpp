@@ -6,19 +6,22 @@
 #include <vector>
 #include <set>
 #include <format>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <thread>
 
 #include "ShipMap.h"
+#include "GameLog.h"
+#include "Targeting.h"
+#include "Simulator.h"
+#include "FleetPlacement.h"
+#include "ShipIndex.h"
+#include "Algorithms.h"
+#include "Instrumentation.h"
 
 using namespace std;
 
-int calcSum( std::span< int > vals )
-{
-	int sum = 0;
-	for( const auto &val : vals )
-		sum += val;
-	return sum;
-}
-
 bool testSum( ostream &out )
 {
 	// Test against std::accumulate
@@ -51,57 +54,6 @@ bool testSum( ostream &out )
 	return true;
 }
 
-using Dictionary = map< string, list< string > >;
-
-// Recursive function that returns true if a cycle was encountered. Uses lots of references in order to track things; this could
-// be simplified by making this part of a class that saved that data instead. 
-bool track_cycle( const Dictionary &dict, const string &start_key, const list< string > &dependencies, set< string > &cyclical_nodes, set< string > &traversed_keys )
-{
-	if( std::find( dependencies.begin(), dependencies.end(), start_key ) != dependencies.end() )
-	{
-		cyclical_nodes.insert( start_key );
-		return true;
-	}
-
-	bool cycle = false;
-	for( const auto &dep : dependencies )
-	{
-		if( !dict.contains( dep ) )
-			continue;
-		if( traversed_keys.contains( dep ) )
-		{
-			cyclical_nodes.insert( dep );
-			cyclical_nodes.insert( start_key );
-			return true;
-		}
-		auto new_deps = dict.at( dep );
-		// Tracking the keys here breaks infinite loops where the start key isn't directly involved in the loop.
-		traversed_keys.insert( dep );
-		cycle |= track_cycle( dict, start_key, new_deps, cyclical_nodes, traversed_keys );
-	}
-	traversed_keys.insert( start_key );
-	return cycle;
-}
-
-/// Returns an ordered set of all nodes involved in circular references. 
-set< string > getCircularDependencies( Dictionary dict )
-{
-	set< string > circular_nodes;
-
-	for( const auto &[ key, deps ] : dict )
-	{
-		if( circular_nodes.contains( key ) )
-			continue;
-		// could increase efficiency by putting this outside the loop and skipping keys that have been traversed
-		// as part of other keys
-		set< string > traversed_keys;
-		track_cycle( dict, key, deps, circular_nodes, traversed_keys );
-	}
-
-	return circular_nodes;
-}
-
-
 bool testCircularDependencies( ostream &out )
 {
 	Dictionary test_dict =
@@ -158,6 +110,569 @@ bool testShipSinking( ostream &out )
 	return true;
 }
 
+// Compares what's visible on the board, plus whether each ship is in the same place.
+bool sameBoard( const Map &a, const Map &b )
+{
+	for( unsigned x = 0; x < MAP_SIZE; ++x )
+		for( unsigned y = 0; y < MAP_SIZE; ++y )
+			if( a.getStatus( { x, y } ) != b.getStatus( { x, y } ) )
+				return false;
+	if( a.getShips().size() != b.getShips().size() )
+		return false;
+	for( size_t i = 0; i < a.getShips().size(); ++i )
+		if( !( a.getShips()[ i ].getStart() == b.getShips()[ i ].getStart() ) )
+			return false;
+	return a.pickedCount() == b.pickedCount() && a.hitCount() == b.hitCount() && a.shipsRemaining() == b.shipsRemaining();
+}
+
+bool testGameLog( ostream &out )
+{
+	try
+	{
+		Map live;
+		GameLog log( 16 );
+		log.addShip( live, Ship( { 0, 0 }, { 4, 0 }, "Carrier" ) );
+		log.addShip( live, Ship( { 2, 2 }, { 2, 5 }, "Battleship" ) );
+		log.addShip( live, Ship( { 7, 9 }, { 9, 9 }, "Submarine" ) );
+
+		// Shoot every other point, so the log crosses a few snapshots.
+		for( unsigned x = 0; x < MAP_SIZE; ++x )
+			for( unsigned y = x % 2; y < MAP_SIZE; y += 2 )
+				log.checkShot( live, { x, y } );
+		log.checkShot( live, { 0, 0 } );
+
+		if( !log.undoLastShot( live ) || !log.undoLastShot( live ) )
+			throw std::exception( "Undo of a shot failed." );
+		if( live.getStatus( { 9, 9 } ) != PointStatus::HAS_SHIP )
+			throw std::exception( "Undo didn't restore the ship point." );
+		out << "Re-shot after undo: " << log.checkShot( live, { 9, 9 } ) << endl;
+
+		if( !sameBoard( live, log.replay() ) || !sameBoard( live, log.replayFromStart() ) )
+			throw std::exception( "Replayed board doesn't match the live one." );
+
+		// Replay marks all the shots at once, so a ship placed on an earlier shot still starts hit.
+		Map late;
+		GameLog late_log;
+		late_log.checkShot( late, { 5, 5 } );
+		late_log.addShip( late, Ship( { 5, 5 }, { 5, 6 }, "Destroyer" ) );
+		late_log.checkShot( late, { 5, 6 } );
+		if( late.shipsRemaining() != 0 || !sameBoard( late, late_log.replay() ) || !sameBoard( late, late_log.replayFromStart() ) )
+			throw std::exception( "Replay of a ship placed on an earlier shot doesn't match." );
+
+		std::stringstream buffer;
+		log.write( buffer );
+		GameLog loaded;
+		if( !loaded.read( buffer ) || !sameBoard( live, loaded.replay() ) )
+			throw std::exception( "Board read back from the binary log doesn't match." );
+		out << log.getEvents().size() << " events, " << log.snapshotCount() << " snapshots, " << buffer.str().size() << " bytes" << endl;
+
+		// Corrupt counts must fail the read, not try to allocate what they claim.
+		auto le32 = []( uint32_t value ) { return string{ char( value ), char( value >> 8 ), char( value >> 16 ), char( value >> 24 ) }; };
+		string header = "BSLG" + le32( 2 ) + le32( 64 );
+		for( const auto &corrupt : { header + le32( 0 ) + le32( 0xFFFFFFFFu ), header + le32( 1 ) + le32( 0xFFFFFFFFu ) + "Carrier" } )
+		{
+			std::stringstream corrupt_stream( corrupt );
+			if( loaded.read( corrupt_stream ) || !loaded.getEvents().empty() )
+				throw std::exception( "Reading a log with a corrupt count should fail cleanly." );
+		}
+	}
+	catch( std::exception e )
+	{
+		out << "Test 4 failed: " << e.what() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Counts placements one at a time, for checking the engine against.
+vector< uint32_t > bruteForceDensity( const BoardView &view )
+{
+	vector< uint32_t > density( view.cells.size(), 0 );
+	for( auto length : view.remaining )
+	{
+		for( unsigned axis = 0; axis < 2; ++axis )
+		{
+			for( unsigned y = 0; y < view.height; ++y )
+			{
+				for( unsigned x = 0; x < view.width; ++x )
+				{
+					if( ( axis == 0 ? x : y ) + length > ( axis == 0 ? view.width : view.height ) )
+						continue;
+					bool legal = true;
+					uint32_t weight = 1;
+					for( unsigned i = 0; i < length; ++i )
+					{
+						auto cell = view.at( axis == 0 ? Point2D{ x + i, y } : Point2D{ x, y + i } );
+						legal &= ( cell == CellView::UNKNOWN || cell == CellView::HIT );
+						weight += ( cell == CellView::HIT ? 32 : 0 );
+					}
+					if( !legal )
+						continue;
+					for( unsigned i = 0; i < length; ++i )
+					{
+						Point2D point = axis == 0 ? Point2D{ x + i, y } : Point2D{ x, y + i };
+						if( view.at( point ) == CellView::UNKNOWN )
+							density[ point.y * view.width + point.x ] += weight;
+					}
+				}
+			}
+		}
+	}
+	return density;
+}
+
+bool testTargeting( ostream &out )
+{
+	try
+	{
+		Map map;
+		map.addShip( Ship( { 1, 1 }, { 5, 1 }, "Carrier" ) );
+		map.addShip( Ship( { 8, 2 }, { 8, 5 }, "Battleship" ) );
+		map.addShip( Ship( { 3, 7 }, { 5, 7 }, "Destroyer" ) );
+		map.addShip( Ship( { 0, 9 }, { 1, 9 }, "Patrol Boat" ) );
+		for( Point2D shot : { Point2D{ 0, 0 }, Point2D{ 3, 1 }, Point2D{ 4, 4 }, Point2D{ 0, 9 }, Point2D{ 1, 9 }, Point2D{ 6, 6 } } )
+			map.checkShot( shot );
+
+		auto view = BoardView::fromMap( map );
+		TargetingEngine engine;
+		if( engine.computeDensity( view ) != bruteForceDensity( view ) )
+			throw std::exception( "Targeting density doesn't match brute force placement counting." );
+
+		auto best = engine.bestShot( view );
+		out << "Best shot after hitting (3,1): (" << best.x << "," << best.y << ")" << endl;
+		if( !( ( best.y == 1 && ( best.x == 2 || best.x == 4 ) ) || ( best.x == 3 && ( best.y == 0 || best.y == 2 ) ) ) )
+			throw std::exception( "Best shot should be next to the unsunk hit." );
+
+		// Non-square board split into bands: the threaded passes have to agree with one thread
+		// and brute force, whatever the core count. A zero length ship has no placements.
+		BoardView uneven( 37, 23 );
+		uneven.remaining = { 5, 4, 3, 3, 2, 0 };
+		SplitMix64 view_rng{ 17 };
+		for( auto &cell : uneven.cells )
+		{
+			unsigned roll = view_rng.below( 20 );
+			cell = roll < 3 ? CellView::MISS : ( roll == 3 ? CellView::HIT : ( roll == 4 ? CellView::SUNK : CellView::UNKNOWN ) );
+		}
+		TargetingEngine single_engine( 1 ), banded_engine( 4 );
+		auto expected = bruteForceDensity( uneven );
+		if( single_engine.computeDensity( uneven ) != expected || banded_engine.computeDensity( uneven ) != expected )
+			throw std::exception( "Density with 4 threads doesn't match 1 thread and brute force." );
+
+		// Large board with a sprinkling of misses and a standard fleet left.
+		BoardView large( 1000, 1000 );
+		large.remaining = { 5, 4, 3, 3, 2 };
+		mt19937 rng( 1234 );
+		for( auto &cell : large.cells )
+			cell = ( rng() % 10 == 0 ) ? CellView::MISS : CellView::UNKNOWN;
+		large.at( { 500, 500 } ) = CellView::HIT;
+
+		for( unsigned threads : { 1u, max( 1u, std::thread::hardware_concurrency() ) } )
+		{
+			best = TargetingEngine( threads ).bestShot( large );
+			if( !( best.x == 500 && ( best.y == 499 || best.y == 501 ) ) && !( best.y == 500 && ( best.x == 499 || best.x == 501 ) ) )
+				throw std::exception( "Best shot on the large board should be next to the hit." );
+		}
+		out << "1000x1000 best shot: (" << best.x << "," << best.y << ")" << endl;
+	}
+	catch( std::exception e )
+	{
+		out << "Test 5 failed: " << e.what() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool testSimulator( ostream &out )
+{
+	try
+	{
+		SimulationConfig config;
+		config.games = 2000;
+		config.seed = 42;
+
+		// Same seed, different thread counts: the games, and so the results, should be identical.
+		auto hunt_target = []() { return std::make_unique< HuntTargetShotPolicy >(); };
+		auto single = runSimulation( config, hunt_target );
+		config.threads = 3;
+		auto threaded = runSimulation( config, hunt_target );
+		if( single.shots_to_win != threaded.shots_to_win || single.unfinished != 0 )
+			throw std::exception( "Simulation results depend on the thread count." );
+		out << "Hunt/target: mean " << single.meanShots() << " shots to win" << endl;
+
+		config.threads = 1;
+		out << "Random: mean " << runSimulation( config, []() { return std::make_unique< RandomShotPolicy >(); } ).meanShots() << " shots to win" << endl;
+
+		auto density = runSimulation( config, []() { return std::make_unique< DensityShotPolicy >(); } );
+		out << "Density: mean " << density.meanShots() << " shots to win" << endl;
+		if( density.meanShots() >= single.meanShots() )
+			throw std::exception( "Density targeting should beat hunt/target on average." );
+
+		// A fleet that doesn't fit the board can't be won.
+		constexpr FleetEntry huge[] = { { "Huge", MAP_SIZE + 1 } };
+		config.games = 100;
+		config.fleet = huge;
+		auto unplaceable = runSimulation( config, hunt_target );
+		if( unplaceable.unfinished != config.games || unplaceable.meanShots() != 0.0 )
+			throw std::exception( "Games whose fleet couldn't be placed shouldn't count as wins." );
+	}
+	catch( std::exception e )
+	{
+		out << "Test 6 failed: " << e.what() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool testFleetPlacement( ostream &out )
+{
+	try
+	{
+		// Two orientations, and (MAP_SIZE - 4) starting points along each of MAP_SIZE lines.
+		PlacementTable carrier( 5 );
+		if( carrier.getPlacements().size() != 2 * ( MAP_SIZE - 4 ) * MAP_SIZE )
+			throw std::exception( "Wrong number of placements for a ship of length 5." );
+
+		FleetPlacer placer;
+		Map map;
+		SplitMix64 rng{ 1 };
+		for( unsigned i = 0; i < 1000; ++i )
+		{
+			map.clear();
+			if( !placer.place( map, rng ) || map.getShips().size() != STANDARD_FLEET.size() )
+				throw std::exception( "Fleet placement didn't place every ship." );
+		}
+
+		// Placed ships skip addShip's checks, so make sure the board still adds up: every
+		// point occupied once, and shooting them all sinks every ship.
+		unsigned fleet_points = 0;
+		for( const auto &entry : STANDARD_FLEET )
+			fleet_points += entry.length;
+		if( map.getOccupied().count() != fleet_points )
+			throw std::exception( "Placed ships overlap." );
+		for( Point2D point : map.getOccupied() )
+			map.checkShot( point );
+		if( !map.isGameOver() || map.hitCount() != fleet_points )
+			throw std::exception( "Shooting every placed point should sink the fleet." );
+
+		// Ships already on the board are placed around, and kept if the fleet doesn't fit.
+		for( unsigned i = 0; i < 100; ++i )
+		{
+			map.clear();
+			map.addShip( Ship( { 0, 4 }, { 9, 4 }, "Wall" ) );
+			if( !placer.place( map, rng ) || map.getOccupied().count() != fleet_points + MAP_SIZE )
+				throw std::exception( "Fleet placement overlapped a ship already on the board." );
+		}
+		constexpr FleetEntry huge[] = { { "Huge", MAP_SIZE + 1 } };
+		if( FleetPlacer( huge ).place( map, rng ) || map.getShips().size() != STANDARD_FLEET.size() + 1 )
+			throw std::exception( "A fleet that doesn't fit should leave the map as it was." );
+
+
+		// 42 of the 100 points taken; both ways of placing should still manage it.
+		constexpr FleetEntry crowded[] =
+		{
+			{ "A", 5 }, { "B", 5 }, { "C", 4 }, { "D", 4 }, { "E", 4 }, { "F", 3 }, { "G", 3 },
+			{ "H", 3 }, { "I", 3 }, { "J", 2 }, { "K", 2 }, { "L", 2 }, { "M", 2 }
+		};
+		FleetPlacer crowded_placer( crowded );
+		for( unsigned i = 0; i < 100; ++i )
+		{
+			map.clear();
+			if( !crowded_placer.place( map, rng ) || map.getOccupied().count() != 42 )
+				throw std::exception( "Crowded fleet placement didn't place every ship." );
+			map.clear();
+			placeFleetByRetry( map, rng, crowded );
+			if( map.getOccupied().count() != 42 )
+				throw std::exception( "Crowded fleet retries didn't place every ship." );
+		}
+	}
+	catch( std::exception e )
+	{
+		out << "Test 7 failed: " << e.what() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool testShipIndex( ostream &out )
+{
+	try
+	{
+		// Large sparse board: ships on a few thousand rows and columns out of a million.
+		constexpr unsigned BOARD = 1000000;
+		constexpr unsigned LINES = 2000;
+		SplitMix64 rng{ 3 };
+		vector< Ship > ships;
+		ShipIndex index;
+		vector< Point2D > queries;
+
+		for( unsigned ship_count : { 1000u, 10000u, 50000u } )
+		{
+			while( ships.size() < ship_count )
+			{
+				unsigned span = 1 + rng.below( 4 );
+				bool horizontal = rng.below( 2 ) == 0;
+				unsigned line = rng.below( LINES ) * ( BOARD / LINES );
+				unsigned along = rng.below( BOARD - span );
+				Point2D start = horizontal ? Point2D{ along, line } : Point2D{ line, along };
+				Point2D end = horizontal ? Point2D{ along + span, line } : Point2D{ line, along + span };
+				Ship ship( start, end, "" );
+				if( index.insert( ship, static_cast< uint32_t >( ships.size() ) ) )
+					ships.push_back( ship );
+			}
+
+			// Half the queries on a ship, half on the lines ships use.
+			queries.clear();
+			for( unsigned i = 0; i < 100000; ++i )
+			{
+				const auto &ship = ships[ rng.below( static_cast< unsigned >( ships.size() ) ) ];
+				unsigned offset = rng.below( ship.length() );
+				Point2D on_ship = ship.orthogonalX() ? Point2D{ ship.getStart().x + offset, ship.getStart().y } : Point2D{ ship.getStart().x, ship.getStart().y + offset };
+				queries.push_back( i % 2 ? on_ship : Point2D{ rng.below( BOARD ), on_ship.y } );
+			}
+
+			// Check against scanning every ship, on a sample since the scan is slow.
+			for( unsigned i = 0; i < 200; ++i )
+			{
+				uint32_t expected = ShipIndex::NO_SHIP;
+				for( uint32_t id = 0; id < ships.size() && expected == ShipIndex::NO_SHIP; ++id )
+					expected = ships[ id ].isHit( queries[ i ] ) ? id : ShipIndex::NO_SHIP;
+				if( index.find( queries[ i ] ) != expected )
+					throw std::exception( "Ship index disagrees with scanning the ships." );
+			}
+
+			size_t found = 0;
+			for( const auto &query : queries )
+				found += ( index.find( query ) != ShipIndex::NO_SHIP );
+			if( found < queries.size() / 2 )
+				throw std::exception( "Ship index missed ships it should have found." );
+			out << ship_count << " ships: " << found << " of " << queries.size() << " queries found a ship" << endl;
+		}
+	}
+	catch( std::exception e )
+	{
+		out << "Test 8 failed: " << e.what() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Exhaustive search to a fixed depth, cloning the map at every node. Returns the nodes visited.
+size_t searchNodes( const Map &map, unsigned depth )
+{
+	if( depth == 0 )
+		return 1;
+
+	size_t nodes = 1;
+	for( Point2D shot : map.unpicked() )
+	{
+		Map child = map;
+		child.checkShot( shot );
+		nodes += searchNodes( child, depth - 1 );
+	}
+	return nodes;
+}
+
+bool testMapCloning( ostream &out )
+{
+	try
+	{
+		Map original;
+		SplitMix64 rng{ 11 };
+		FleetPlacer().place( original, rng );
+
+		// Clones share the fleet; shots and new ships on the clone mustn't show up on the original.
+		Map clone = original;
+		const auto &ship = clone.getShips()[ 0 ];
+		clone.checkShot( ship.getStart() );
+		if( original.getStatus( ship.getStart() ) != PointStatus::HAS_SHIP || clone.getStatus( ship.getStart() ) != PointStatus::PICKED )
+			throw std::exception( "A shot on a cloned map changed the original." );
+		for( unsigned y = 0; y < MAP_SIZE && clone.getShips().size() == original.getShips().size(); ++y )
+			for( unsigned x = 0; x < MAP_SIZE && clone.getShips().size() == original.getShips().size(); ++x )
+				clone.addShip( Ship( { x, y }, { x, y }, "Dinghy" ) );
+		if( original.getShips().size() != STANDARD_FLEET.size() || clone.getShips().size() != STANDARD_FLEET.size() + 1 )
+			throw std::exception( "Adding a ship to a cloned map changed the original." );
+
+		out << "sizeof( Map ): " << sizeof( Map ) << " bytes" << endl;
+
+		unsigned picked = 0;
+		for( unsigned i = 0; i < BoardMask::CELLS; ++i )
+		{
+			Map copy = original;
+			copy.checkShot( BoardMask::point( i ) );
+			picked += copy.getPicked().count();
+		}
+		if( picked != BoardMask::CELLS || original.pickedCount() != 0 )
+			throw std::exception( "Each clone should have exactly one point picked." );
+
+		// Every node shoots each point its parent left unpicked: 1 + 100 + 100 * 99.
+		size_t nodes = searchNodes( original, 2 );
+		out << "Depth 2 search: " << nodes << " nodes" << endl;
+		if( nodes != 1 + BoardMask::CELLS + BoardMask::CELLS * ( BoardMask::CELLS - 1 ) )
+			throw std::exception( "Search from cloned maps visited the wrong number of nodes." );
+	}
+	catch( std::exception e )
+	{
+		out << "Test 9 failed: " << e.what() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool testBoardStats( ostream &out )
+{
+	try
+	{
+		Map map;
+		SplitMix64 rng{ 5 };
+		FleetPlacer().place( map, rng );
+
+		// Play through in a random order, undoing every fifth shot, and check the running
+		// totals against counting them the slow way after each move.
+		unsigned moves = 0;
+		while( !map.isGameOver() )
+		{
+			vector< Point2D > unpicked;
+			for( Point2D point : map.unpicked() )
+				unpicked.push_back( point );
+
+			unsigned picked = 0, hits = 0, afloat = 0;
+			for( unsigned y = 0; y < MAP_SIZE; ++y )
+			{
+				for( unsigned x = 0; x < MAP_SIZE; ++x )
+				{
+					bool is_picked = map.getStatus( { x, y } ) == PointStatus::PICKED;
+					picked += is_picked;
+					hits += is_picked && map.getOccupied().test( { x, y } );
+				}
+			}
+			for( size_t i = 0; i < map.getShips().size(); ++i )
+				afloat += !map.isShipSunk( i );
+
+			if( unpicked.size() != map.unpickedCount() || picked != map.pickedCount() ||
+				hits != map.hitCount() || afloat != map.shipsRemaining() )
+			{
+				throw std::exception( "Board statistics don't match a scan of the board." );
+			}
+
+			Point2D shot = unpicked[ rng.below( static_cast< unsigned >( unpicked.size() ) ) ];
+			map.checkShot( shot );
+			if( ++moves % 5 == 0 )
+				map.undoShot( shot );
+		}
+		out << "Game over after " << map.pickedCount() << " shots, hit ratio " << map.hitRatio() << endl;
+	}
+	catch( std::exception e )
+	{
+		out << "Test 10 failed: " << e.what() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool testInstrumentation( ostream &out )
+{
+	try
+	{
+		instrumentation::reset();
+
+		// Some calls from this thread and some from workers; the dump should add them all up.
+		vector< int > values( 1000, 1 );
+		calcSum( values );
+		calcSum( span< int >( values ).first( 10 ) );
+		vector< thread > workers;
+		for( unsigned i = 0; i < 2; ++i )
+			workers.emplace_back( [&values]() { calcSum( values ); } );
+		for( auto &worker : workers )
+			worker.join();
+
+		Dictionary dict = { { "a", { "b" } }, { "b", { "c" } }, { "c", { "a" } }, { "d", { "a" } } };
+		getCircularDependencies( dict );
+
+		Map map;
+		SplitMix64 rng{ 11 };
+		FleetPlacer().place( map, rng );
+		Map checked;
+		checked.addShip( Ship( { 0, 0 }, { 2, 0 }, "Cruiser" ) );
+		for( unsigned y = 0; y < MAP_SIZE; ++y )
+		{
+			for( unsigned x = 0; x < MAP_SIZE; ++x )
+				map.checkShot( { x, y } );
+		}
+
+		auto reports = instrumentation::collect();
+		auto find_probe = [&reports]( const string &name ) -> const instrumentation::ProbeStats &
+		{
+			for( const auto &report : reports )
+			{
+				if( report.name == name )
+					return report.stats;
+			}
+			throw std::exception( "Probe missing from the report." );
+		};
+
+		if( instrumentation::enabled() )
+		{
+			const auto &elements = find_probe( "calcSum elements" );
+			if( elements.count != 4 || elements.total != 3010 || elements.min != 10 || elements.max != 1000 )
+				throw std::exception( "calcSum element counts weren't collected from every thread." );
+			if( find_probe( "calcSum" ).count != 4 )
+				throw std::exception( "calcSum timer count is wrong." );
+			if( find_probe( "track_cycle depth" ).max < 2 || find_probe( "track_cycle nodes visited" ).total == 0 )
+				throw std::exception( "Cycle detection probes didn't record the recursion." );
+			// Each add is timed once, by whichever entry point it came through.
+			if( find_probe( "Map::addShip" ).count != 1 || find_probe( "Map::addPlacedShip" ).count != STANDARD_FLEET.size() )
+				throw std::exception( "Expected one timing per ship added." );
+			if( find_probe( "Map::checkShot" ).count != MAP_SIZE * MAP_SIZE )
+				throw std::exception( "Expected one checkShot timing per shot." );
+			// One record per shot that wasn't a repeat, however many lines the index searched.
+			const auto &searched = find_probe( "Map::checkShot ships searched" );
+			if( searched.count != MAP_SIZE * MAP_SIZE || searched.total < map.hitCount() )
+				throw std::exception( "Expected one ships searched record per shot." );
+
+			// Rough cost of a probe: a loop of counters against the same loop without them.
+			constexpr unsigned PROBES = 1000000;
+			volatile unsigned sink = 0;
+			auto start = chrono::steady_clock::now();
+			for( unsigned i = 0; i < PROBES; ++i )
+				sink = sink + i;
+			auto bare = chrono::steady_clock::now() - start;
+			start = chrono::steady_clock::now();
+			for( unsigned i = 0; i < PROBES; ++i )
+			{
+				INSTRUMENT_COUNT( "probe overhead", 1 );
+				sink = sink + i;
+			}
+			auto probed = chrono::steady_clock::now() - start;
+			out << "About " << chrono::duration< double, nano >( probed - bare ).count() / PROBES << " ns per counter probe" << endl;
+		}
+		else if( !reports.empty() )
+		{
+			throw std::exception( "Probes were registered with instrumentation compiled out." );
+		}
+
+		instrumentation::dumpText( out );
+		ostringstream json;
+		instrumentation::dumpJson( json );
+		if( json.str().front() != '{' )
+			throw std::exception( "JSON dump is malformed." );
+		out << json.str();
+	}
+	catch( std::exception e )
+	{
+		out << "Test 11 failed: " << e.what() << endl;
+		return false;
+	}
+
+	return true;
+}
+
 int main()
 {
 	cout << "Question 1: Write a function that iterates through an integer array and returns the sum of the values in the array." << endl;
@@ -175,5 +690,37 @@ int main()
 	if( !testShipSinking( cout ) )
 		return 3;
 
+	cout << "Event log: record a game, undo shots, and replay it from the binary log." << endl;
+	if( !testGameLog( cout ) )
+		return 4;
+
+	cout << "Targeting: pick the next shot from the placements that are still possible." << endl;
+	if( !testTargeting( cout ) )
+		return 5;
+
+	cout << "Self-play: simulate complete games with different shot policies." << endl;
+	if( !testSimulator( cout ) )
+		return 6;
+
+	cout << "Fleet placement: sample random fleets from precomputed placement masks." << endl;
+	if( !testFleetPlacement( cout ) )
+		return 7;
+
+	cout << "Ship index: find the ship under a shot on a large board with many ships." << endl;
+	if( !testShipIndex( cout ) )
+		return 8;
+
+	cout << "Map cloning: copies share the fleet, so search can clone a map per node." << endl;
+	if( !testMapCloning( cout ) )
+		return 9;
+
+	cout << "Board statistics: ships afloat, points left and hit ratio without scanning the board." << endl;
+	if( !testBoardStats( cout ) )
+		return 10;
+
+	cout << "Instrumentation: counters, timers and histograms from the hot paths (build with ENABLE_INSTRUMENTATION)." << endl;
+	if( !testInstrumentation( cout ) )
+		return 11;
+
 	return 0;
 }
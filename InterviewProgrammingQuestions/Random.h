@@ -0,0 +1,27 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// Small, fast generator; seeding it is free, which matters when it's reseeded every game.
+struct SplitMix64
+{
+	std::uint64_t state = 0;
+
+	std::uint64_t next()
+	{
+		std::uint64_t z = ( state += 0x9E3779B97F4A7C15ull );
+		z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+		z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+		return z ^ ( z >> 31 );
+	}
+
+	// Uniform in [0, bound), by multiply-shift rather than modulo.
+	unsigned below( unsigned bound )
+	{
+		return static_cast< unsigned >( ( ( next() >> 32 ) * bound ) >> 32 );
+	}
+};
+
+
+#endif
@@ -0,0 +1,111 @@
+#include "ShipIndex.h"
+#include "ShipMap.h"
+
+#include <algorithm>
+
+bool ShipIndex::insert( const Ship &ship, std::uint32_t id )
+{
+	if( overlaps( ship ) )
+		return false;
+	insertUnchecked( ship, id );
+	return true;
+}
+
+void ShipIndex::insertUnchecked( const Ship &ship, std::uint32_t id )
+{
+	const auto &start = ship.getStart();
+	const auto &end = ship.getEnd();
+	Interval interval = ship.orthogonalX() ? Interval{ start.x, end.x, id } : Interval{ start.y, end.y, id };
+	auto &line = ship.orthogonalX() ? mRows[ start.y ] : mColumns[ start.x ];
+
+	// Keep the line sorted by first point; since nothing overlaps, that sorts by last point too.
+	auto position = std::upper_bound( line.begin(), line.end(), interval.first,
+		[]( unsigned first, const Interval &other ) { return first < other.first; } );
+	line.insert( position, interval );
+	++mSize;
+}
+
+std::uint32_t ShipIndex::find( Point2D point ) const
+{
+	unsigned searched = 0;
+	return find( point, searched );
+}
+
+std::uint32_t ShipIndex::find( Point2D point, unsigned &searched ) const
+{
+	std::uint32_t id = findInLine( mRows, point.y, point.x, searched );
+	if( id != NO_SHIP )
+		return id;
+	return findInLine( mColumns, point.x, point.y, searched );
+}
+
+bool ShipIndex::overlaps( const Ship &ship ) const
+{
+	const auto &start = ship.getStart();
+	const auto &end = ship.getEnd();
+	unsigned searched = 0;
+	if( ship.orthogonalX() )
+	{
+		// Another horizontal ship in the same row, or a vertical one crossing it.
+		if( overlapsInLine( mRows, start.y, start.x, end.x ) )
+			return true;
+		for( unsigned x = start.x; x <= end.x; ++x )
+		{
+			if( findInLine( mColumns, x, start.y, searched ) != NO_SHIP )
+				return true;
+		}
+	}
+	else
+	{
+		if( overlapsInLine( mColumns, start.x, start.y, end.y ) )
+			return true;
+		for( unsigned y = start.y; y <= end.y; ++y )
+		{
+			if( findInLine( mRows, y, start.x, searched ) != NO_SHIP )
+				return true;
+		}
+	}
+	return false;
+}
+
+void ShipIndex::clear()
+{
+	// Empty the lines but keep them, so refilling the same board doesn't allocate.
+	for( auto &[ row, line ] : mRows )
+		line.clear();
+	for( auto &[ column, line ] : mColumns )
+		line.clear();
+	mSize = 0;
+}
+
+std::uint32_t ShipIndex::findInLine( const std::unordered_map< unsigned, Line > &lines, unsigned line, unsigned position, unsigned &searched )
+{
+	auto found = lines.find( line );
+	if( found == lines.end() )
+		return NO_SHIP;
+
+	// The last interval starting at or before the position is the only one that can cover it.
+	const auto &intervals = found->second;
+	searched += static_cast< unsigned >( intervals.size() );
+	auto after = std::upper_bound( intervals.begin(), intervals.end(), position,
+		[]( unsigned point, const Interval &interval ) { return point < interval.first; } );
+	if( after == intervals.begin() )
+		return NO_SHIP;
+	const auto &candidate = *( after - 1 );
+	return ( position <= candidate.last ) ? candidate.id : NO_SHIP;
+}
+
+bool ShipIndex::overlapsInLine( const std::unordered_map< unsigned, Line > &lines, unsigned line, unsigned first, unsigned last )
+{
+	auto found = lines.find( line );
+	if( found == lines.end() )
+		return false;
+
+	// Only the last interval starting at or before `last` can reach back into [first, last].
+	const auto &intervals = found->second;
+	auto after = std::upper_bound( intervals.begin(), intervals.end(), last,
+		[]( unsigned point, const Interval &interval ) { return point < interval.first; } );
+	if( after == intervals.begin() )
+		return false;
+	return ( after - 1 )->last >= first;
+}
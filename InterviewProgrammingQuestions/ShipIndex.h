@@ -0,0 +1,60 @@
+#ifndef SHIP_INDEX_H
+#define SHIP_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Map holds one of these, so only declare what's needed rather than include ShipMap.h.
+struct Point2D;
+class Ship;
+
+// Finds which ship (if any) covers a point, without scanning every ship and without a
+// per-point grid. Horizontal ships are kept as sorted intervals in their row, vertical
+// ships as sorted intervals in their column; only rows and columns that have ships take
+// any space, so huge sparse boards are cheap. A lookup is a binary search in the point's
+// row and one in its column.
+class ShipIndex
+{
+public:
+	static constexpr std::uint32_t NO_SHIP = ~std::uint32_t{ 0 };
+
+	// Adds a ship under the given id, or returns false if it overlaps one already indexed.
+	bool insert( const Ship &ship, std::uint32_t id );
+	// Same, for callers that have already checked the ship doesn't overlap anything
+	// (Map checks its occupied mask). Overlapping ships here break find.
+	void insertUnchecked( const Ship &ship, std::uint32_t id );
+
+	// Id of the ship covering the point, or NO_SHIP.
+	std::uint32_t find( Point2D point ) const;
+	// Same, adding the number of intervals in the lines searched to searched.
+	std::uint32_t find( Point2D point, unsigned &searched ) const;
+
+	// Returns whether the ship would overlap anything already indexed.
+	bool overlaps( const Ship &ship ) const;
+
+	// Removes every ship, keeping the storage for reuse.
+	void clear();
+	std::size_t size() const { return mSize; }
+
+private:
+	// Points [first, last] along one row or column, inclusive like Ship's start and end.
+	struct Interval
+	{
+		unsigned first;
+		unsigned last;
+		std::uint32_t id;
+	};
+	using Line = std::vector< Interval >;
+
+	// Keyed by y for horizontal ships, by x for vertical ones. A one point ship counts as horizontal.
+	std::unordered_map< unsigned, Line > mRows;
+	std::unordered_map< unsigned, Line > mColumns;
+	std::size_t mSize = 0;
+
+	static std::uint32_t findInLine( const std::unordered_map< unsigned, Line > &lines, unsigned line, unsigned position, unsigned &searched );
+	static bool overlapsInLine( const std::unordered_map< unsigned, Line > &lines, unsigned line, unsigned first, unsigned last );
+};
+
+#endif
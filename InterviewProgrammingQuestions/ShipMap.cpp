@@ -1,6 +1,9 @@
 #include "ShipMap.h"
+#include "Instrumentation.h"
 
-Ship::Ship( Point2D start_coord, Point2D end_coord, std::string name ) : mStart{ start_coord }, mEnd{ end_coord }, mName{ name }
+#include <algorithm>
+
+Ship::Ship( Point2D start_coord, Point2D end_coord, std::string name ) : mStart{ start_coord }, mEnd{ end_coord }, mName{ std::move( name ) }
 {
 	init();
 }
@@ -21,135 +24,170 @@ bool Ship::init()
 
 	auto ship_length = ( mOnXAxis ? mEnd.x - mStart.x : mEnd.y - mStart.y );
 	// Number of "hits" is length + 1 (also handles single position ship)
-	mHits.resize( ship_length + 1u, 0 );
+	mLength = ship_length + 1u;
 
 	return isValid();
 }
 
 bool Ship::isHit( Point2D shot ) const
 {
-	if( shot < mStart )
-		return false;
-
-	// fix logic here, there are other non-hit values?
+	// The shot has to be on the ship's line, between start and end inclusive.
 	if( mOnXAxis )
-		return shot.y <= mEnd.y;
+		return shot.y == mStart.y && shot.x >= mStart.x && shot.x <= mEnd.x;
 	else
-		return shot.x <= mEnd.x;
-
-	return true;
+		return shot.x == mStart.x && shot.y >= mStart.y && shot.y <= mEnd.y;
 }
 
-bool Ship::hit( Point2D shot )
+Map::Map() : mFleet{ std::make_shared< Fleet >() }
 {
-	if( !isHit( shot ) )
-		return false;
-
-	// Update the hit status
-	unsigned offset = ( mOnXAxis ? shot.x - mStart.x : shot.y - mStart.y );
-	if( offset >= mHits.size() )
-		throw std::exception( "offset out of bounds, logic is bad" );
-	mHits[ offset ] = 1u;
-
-	// If there's no 0 found in the hits (i.e. no unhit spots), we're sunk.
-	// could also do a sum of all values and ensure it's < mHits.size()
-	if( std::find( mHits.begin(), mHits.end(), 0 ) == mHits.end() )
-		return true;
-
-	return false;
-}
-
-Map::Map()
-{
-	// Init the map status
-	initMapStatus();
 }
 
 std::tuple< HitType, std::string > Map::checkShot( Point2D coords )
 {
-	auto &status = mPoints[ coords.x ][ coords.y ];
-	
+	INSTRUMENT_SCOPE( "Map::checkShot" );
 	// early out: repeats
-	
-	switch( status )
-	{
-	case PointStatus::PICKED:
+	if( mPicked.test( coords ) )
 		return std::make_tuple< HitType, std::string >( HitType::REPEAT, "" );
-	case PointStatus::EMPTY:
+
+	mPicked.set( coords );
+	++mPickedCount;
+	if( !mFleet->occupied.test( coords ) )
 	{
-		status = PointStatus::PICKED;
+		// Misses never reach the index.
+		INSTRUMENT_RECORD( "Map::checkShot ships searched", 0 );
 		return std::make_tuple< HitType, std::string >( HitType::MISS, "" );
 	}
-	case PointStatus::HAS_SHIP:
+	++mHitCount;
+
+	// Need to know which ship is being hit, and if it sinks: it's sunk once all its points are picked.
+	unsigned searched = 0;
+	auto id = mFleet->index.find( coords, searched );
+	INSTRUMENT_RECORD( "Map::checkShot ships searched", searched );
+	if( id == ShipIndex::NO_SHIP )
 	{
-		status = PointStatus::PICKED;
-
-		// Need to know which ship is being hit, and if it sinks.
-		for( auto &ship : mShips )
-		{
-			bool hit = ship.isHit( coords );
-			if( !hit )
-				continue;
-			bool sunk = ship.hit( coords );
-			const std::string name = ship.getName();
-			return { ( sunk ? HitType::SUNK : HitType::HIT ), name };
-		}
-	}
+		// should return error here somehow
+		return std::make_tuple< HitType, std::string >( HitType::MISS, "error" );
 	}
-	
-	// should return error here somehow
-	return std::make_tuple< HitType, std::string >( HitType::MISS, "error" );
+	bool sunk = isShipSunk( id );
+	if( sunk )
+		++mSunkCount;
+	return { ( sunk ? HitType::SUNK : HitType::HIT ), mFleet->ships[ id ].getName() };
 }
 
 bool Map::addShip( Ship new_ship )
 {
+	INSTRUMENT_SCOPE( "Map::addShip" );
 	// Disallow invalid ships
 	if( !new_ship.isValid() )
 		return false;
 	const auto &start = new_ship.getStart();
 	const auto &end = new_ship.getEnd();
-	if( !( start < Point2D( MAP_SIZE, MAP_SIZE ) ) ||
-		!( end < Point2D( MAP_SIZE, MAP_SIZE ) ) )
+	if( start.x >= MAP_SIZE || start.y >= MAP_SIZE ||
+		end.x >= MAP_SIZE || end.y >= MAP_SIZE )
 	{
 		return false;
 	}
-	// Check each point for collision. update after
-	std::vector< Point2D > points;
-	if( new_ship.orthogonalX() )
+
+	// Check for collision with everything placed so far in one go.
+	BoardMask mask;
+	for( unsigned i = 0; i < new_ship.length(); ++i )
 	{
-		// Points have the same Y value, differing in X.
-		for( unsigned i = start.x; i <= end.x; ++i )
-		{
-			if( mPoints[ i ][ start.y ] != PointStatus::EMPTY )
-				return false;
-			points.emplace_back( i, start.y );
-		}
+		// Horizontal ships have the same Y value, differing in X, and vice versa.
+		mask.set( new_ship.orthogonalX() ? Point2D{ start.x + i, start.y } : Point2D{ start.x, start.y + i } );
 	}
-	else
+	if( mFleet->occupied.intersects( mask ) )
 	{
-		// Points have the same X value, differing in Y.
-		for( unsigned i = start.y; i <= end.y; ++i )
-		{
-			if( mPoints[ start.x ][ i ] != PointStatus::EMPTY )
-				return false;
-			points.emplace_back( start.y, i );
-		}
+		INSTRUMENT_COUNT( "Map::addShip collisions", 1 );
+		return false;
 	}
 
-	for( const auto &point : points )
+	insertShip( std::move( new_ship ), mask );
+	return true;
+}
+
+void Map::addPlacedShip( Ship new_ship, const BoardMask &mask )
+{
+	INSTRUMENT_SCOPE( "Map::addPlacedShip" );
+	insertShip( std::move( new_ship ), mask );
+}
+
+void Map::insertShip( Ship new_ship, const BoardMask &mask )
+{
+	// Ships can be added mid-game, possibly over points already picked.
+	unsigned already_hit = ( mask & mPicked ).count();
+	mHitCount += already_hit;
+	if( already_hit == new_ship.length() )
+		++mSunkCount;
+
+	auto &fleet = mutableFleet();
+	fleet.occupied |= mask;
+	// Callers have made sure it misses occupied.
+	fleet.index.insertUnchecked( new_ship, static_cast< std::uint32_t >( fleet.ships.size() ) );
+	fleet.masks.push_back( mask );
+	fleet.ships.push_back( std::move( new_ship ) );
+}
+
+bool Map::undoShot( Point2D coords )
+{
+	if( !mPicked.test( coords ) )
+		return false;
+
+	if( mFleet->occupied.test( coords ) )
 	{
-		mPoints[ point.x ][ point.y ] = PointStatus::HAS_SHIP;
+		auto id = mFleet->index.find( coords );
+		if( id != ShipIndex::NO_SHIP && isShipSunk( id ) )
+			--mSunkCount;
+		--mHitCount;
 	}
-	mShips.push_back( new_ship );
+
+	// Ships' hits are just the picked points, so this restores them too.
+	mPicked.reset( coords );
+	--mPickedCount;
 	return true;
-	
 }
 
-void Map::initMapStatus()
+void Map::setPicked( const BoardMask &picked )
+{
+	mPicked = picked;
+	mPickedCount = picked.count();
+	mHitCount = ( picked & mFleet->occupied ).count();
+	mSunkCount = 0;
+	for( const auto &mask : mFleet->masks )
+		mSunkCount += picked.contains( mask ) ? 1u : 0u;
+}
+
+PointStatus Map::getStatus( Point2D coords ) const
+{
+	if( mPicked.test( coords ) )
+		return PointStatus::PICKED;
+	return mFleet->occupied.test( coords ) ? PointStatus::HAS_SHIP : PointStatus::EMPTY;
+}
+
+void Map::clear()
 {
-	// Initialise all points as empty
-	for( unsigned i = 0; i < MAP_SIZE; ++i )
+	mPicked = {};
+	mPickedCount = 0;
+	mHitCount = 0;
+	mSunkCount = 0;
+	if( mFleet.use_count() == 1 )
+	{
+		auto &fleet = *mFleet;
+		fleet.ships.clear();
+		fleet.masks.clear();
+		fleet.occupied = {};
+		fleet.index.clear();
+	}
+	else
 	{
-		mPoints[ i ].fill( PointStatus::EMPTY );
+		// Other copies still use the fleet; leave it to them.
+		mFleet = std::make_shared< Fleet >();
 	}
-}
\ No newline at end of file
+}
+
+Map::Fleet &Map::mutableFleet()
+{
+	// Copy on write: only clone the fleet if another map is looking at it.
+	if( mFleet.use_count() > 1 )
+		mFleet = std::make_shared< Fleet >( *mFleet );
+	return *mFleet;
+}
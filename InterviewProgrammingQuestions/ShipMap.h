@@ -1,13 +1,18 @@
 #ifndef SHIP_MAP_H
 #define SHIP_MAP_H
 
+#include <cstdint>
 #include <string>
 #include <unordered_set>
 #include <array>
+#include <bit>
+#include <memory>
 #include <vector>
 #include <tuple>
 #include <ostream>
 
+#include "ShipIndex.h"
+
 // Given a 2D array( think map ) with "ships" of varying sizes occupying spaces in the array.
 //Create an algorithm which takes in two coordinates as parameters and determine if the coordinates "Miss", "Hit <ship name>", "Already Selected", 
 // or, if the "last spot" of a ship was hit, then "Sunk <ship name>".
@@ -46,13 +51,13 @@ public:
 	// i.e. no diagonal placement. 
 	bool isValid() const;
 
-	// Swap if mStart > mEnd, calc hits (0 for unhit, 1 for hit) 
+	// Swap if mStart > mEnd and calc length
 	bool init();
+	// Returns whether the shot lands on this ship. Ships don't track their own hits;
+	// that's per game, so it lives on the Map (see Map::isShipSunk).
 	bool isHit( Point2D shot ) const;
 
-	// Perform the shot, if it's a hit.
-	// returns whether this ship is sunk
-	bool hit( Point2D shot );
+	unsigned length() const { return mLength; }
 
 	const Point2D &getStart() const { return mStart; }
 	const Point2D &getEnd() const { return mEnd; }
@@ -64,7 +69,7 @@ public:
 
 private:
 	Point2D mStart, mEnd;
-	std::vector< unsigned > mHits;
+	unsigned mLength = 0;
 	std::string mName;
 	bool mOnXAxis = false;
 };
@@ -107,6 +112,137 @@ inline std::ostream &operator<<( std::ostream &out, std::tuple< HitType, std::st
 
 constexpr unsigned MAP_SIZE = 10;
 
+// One bit per point on a MAP_SIZE board, row-major (bit y * MAP_SIZE + x), packed into
+// 64-bit words so whole-board tests are a handful of word operations.
+struct BoardMask
+{
+	static constexpr unsigned CELLS = MAP_SIZE * MAP_SIZE;
+	static constexpr unsigned WORDS = ( CELLS + 63 ) / 64;
+
+	std::array< std::uint64_t, WORDS > words = {};
+
+	static unsigned index( Point2D point ) { return point.y * MAP_SIZE + point.x; }
+	static Point2D point( unsigned index ) { return { index % MAP_SIZE, index / MAP_SIZE }; }
+
+	bool test( Point2D point ) const { return testIndex( index( point ) ); }
+	void set( Point2D point ) { setIndex( index( point ) ); }
+	void reset( Point2D point ) { resetIndex( index( point ) ); }
+
+	bool testIndex( unsigned bit ) const { return ( words[ bit / 64 ] >> ( bit % 64 ) ) & 1u; }
+	void setIndex( unsigned bit ) { words[ bit / 64 ] |= std::uint64_t{ 1 } << ( bit % 64 ); }
+	void resetIndex( unsigned bit ) { words[ bit / 64 ] &= ~( std::uint64_t{ 1 } << ( bit % 64 ) ); }
+
+	// Returns whether every point set in other is also set here.
+	bool contains( const BoardMask &other ) const
+	{
+		std::uint64_t missing = 0;
+		for( unsigned i = 0; i < WORDS; ++i )
+			missing |= other.words[ i ] & ~words[ i ];
+		return missing == 0;
+	}
+
+	bool intersects( const BoardMask &other ) const
+	{
+		std::uint64_t common = 0;
+		for( unsigned i = 0; i < WORDS; ++i )
+			common |= words[ i ] & other.words[ i ];
+		return common != 0;
+	}
+
+	bool none() const
+	{
+		std::uint64_t any = 0;
+		for( auto word : words )
+			any |= word;
+		return any == 0;
+	}
+
+	// Everything not set here, never including the padding past the last point.
+	BoardMask complement() const
+	{
+		BoardMask result;
+		for( unsigned i = 0; i < WORDS; ++i )
+			result.words[ i ] = ~words[ i ];
+		if( CELLS % 64 != 0 )
+			result.words[ WORDS - 1 ] &= ( std::uint64_t{ 1 } << ( CELLS % 64 ) ) - 1;
+		return result;
+	}
+
+	unsigned count() const
+	{
+		unsigned total = 0;
+		for( auto word : words )
+			total += static_cast< unsigned >( std::popcount( word ) );
+		return total;
+	}
+
+	// Walks the set points in index order, a word at a time, so sparse masks are cheap.
+	class PointIterator
+	{
+	public:
+		PointIterator( const BoardMask &mask, unsigned word ) : mMask{ &mask }, mWord{ word }, mBits{ word < WORDS ? mask.words[ word ] : 0 }
+		{
+			skipEmptyWords();
+		}
+
+		Point2D operator*() const { return point( mWord * 64 + static_cast< unsigned >( std::countr_zero( mBits ) ) ); }
+		bool operator!=( const PointIterator &other ) const { return mWord != other.mWord || mBits != other.mBits; }
+		PointIterator &operator++()
+		{
+			// Clear the lowest set bit.
+			mBits &= mBits - 1;
+			skipEmptyWords();
+			return *this;
+		}
+
+	private:
+		const BoardMask *mMask;
+		unsigned mWord;
+		std::uint64_t mBits;
+
+		void skipEmptyWords()
+		{
+			while( mBits == 0 && mWord < WORDS )
+			{
+				++mWord;
+				mBits = ( mWord < WORDS ) ? mMask->words[ mWord ] : 0;
+			}
+		}
+	};
+
+	PointIterator begin() const { return PointIterator( *this, 0 ); }
+	PointIterator end() const { return PointIterator( *this, WORDS ); }
+
+	BoardMask &operator|=( const BoardMask &other )
+	{
+		for( unsigned i = 0; i < WORDS; ++i )
+			words[ i ] |= other.words[ i ];
+		return *this;
+	}
+
+	BoardMask &operator&=( const BoardMask &other )
+	{
+		for( unsigned i = 0; i < WORDS; ++i )
+			words[ i ] &= other.words[ i ];
+		return *this;
+	}
+};
+
+inline bool operator==( const BoardMask &a, const BoardMask &b )
+{
+	return a.words == b.words;
+}
+
+inline BoardMask operator|( BoardMask a, const BoardMask &b )
+{
+	return a |= b;
+}
+
+inline BoardMask operator&( BoardMask a, const BoardMask &b )
+{
+	return a &= b;
+}
+
 class Map
 {
 public:
@@ -118,11 +254,70 @@ public:
 	// Checks whether the coordinates hit, and returns whether it was a hit, miss, or repeat.
 	// Also updates the map status.
 	std::tuple< HitType, std::string > checkShot( Point2D coords );
+
+	// Reverts a previous shot, restoring the point and any ship it hit.
+	// Returns false if the point hadn't been picked.
+	bool undoShot( Point2D coords );
+
+	// Replaces every picked point at once, e.g. when restoring a saved board, and
+	// recomputes the totals from the ships already placed.
+	void setPicked( const BoardMask &picked );
+
+	// Read-only view of the board, used for logging and snapshots.
+	PointStatus getStatus( Point2D coords ) const;
+	const BoardMask &getPicked() const { return mPicked; }
+	const BoardMask &getOccupied() const { return mFleet->occupied; }
+
+	// The ships as placed; whether one is sunk is per game, so ask isShipSunk.
+	const std::vector< Ship > &getShips() const { return mFleet->ships; }
+	bool isShipSunk( size_t ship ) const { return mPicked.contains( mFleet->masks[ ship ] ); }
+
+	// Running totals, kept up to date by addShip, checkShot and undoShot so none of these scan the board.
+	unsigned shipsRemaining() const { return static_cast< unsigned >( mFleet->ships.size() ) - mSunkCount; }
+	unsigned pickedCount() const { return mPickedCount; }
+	unsigned unpickedCount() const { return BoardMask::CELLS - mPickedCount; }
+	unsigned hitCount() const { return mHitCount; }
+	// Fraction of picked points that hit a ship; 0 before the first shot.
+	double hitRatio() const { return mPickedCount ? static_cast< double >( mHitCount ) / mPickedCount : 0.0; }
+	// Over once every ship is sunk (trivially so with no ships).
+	bool isGameOver() const { return shipsRemaining() == 0; }
+
+	// Points not picked yet, for range-for: for( Point2D point : map.unpicked() ).
+	BoardMask unpicked() const { return mPicked.complement(); }
+
+	// Removes every ship and resets all points to empty, keeping the storage for reuse.
+	void clear();
+
 private:
-	std::vector< Ship > mShips;
-	std::array< std::array< PointStatus, MAP_SIZE >, MAP_SIZE > mPoints;
+	// Everything that only changes in addShip. Copies of a map share it, and addShip
+	// copies it first if it's shared, so copying a map (e.g. for each node of a game
+	// tree search) is a pointer and the picked points.
+	struct Fleet
+	{
+		std::vector< Ship > ships;
+		// Points covered by each ship, same order as ships.
+		std::vector< BoardMask > masks;
+		BoardMask occupied;
+		// Which ship covers a point; ids are indices into ships.
+		ShipIndex index;
+	};
+
+	std::shared_ptr< Fleet > mFleet;
+	// The only per-game state: a ship's hits are the picked points within its mask.
+	BoardMask mPicked;
+	unsigned mPickedCount = 0;
+	unsigned mHitCount = 0;
+	unsigned mSunkCount = 0;
+
+	Fleet &mutableFleet();
+	// The bookkeeping shared by addShip and addPlacedShip, once the ship's known to fit.
+	void insertShip( Ship new_ship, const BoardMask &mask );
 
-	void initMapStatus();
+	// For ships whose points are already known, from a placement table. Nothing is
+	// re-checked: the ship must be valid and on the board, mask must be exactly its points,
+	// and it mustn't intersect getOccupied(). Only FleetPlacer can guarantee that.
+	friend class FleetPlacer;
+	void addPlacedShip( Ship new_ship, const BoardMask &mask );
 };
 
 #endif
\ No newline at end of file
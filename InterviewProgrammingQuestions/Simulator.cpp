@@ -0,0 +1,205 @@
+#include "Simulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// A policy that keeps repeating points gets this many shots before the game is abandoned.
+	constexpr unsigned MAX_SHOTS = 4 * MAP_SIZE * MAP_SIZE;
+
+	// Mixes the run seed with a game index, so each game's stream is independent of which thread plays it.
+	std::uint64_t gameSeed( std::uint64_t seed, std::uint64_t game )
+	{
+		SplitMix64 mixer{ seed ^ ( game * 0xD1B54A32D192ED03ull ) };
+		return mixer.next();
+	}
+
+	template< size_t Count >
+	void shuffle( std::array< Point2D, Count > &points, unsigned first, unsigned last, SplitMix64 &rng )
+	{
+		for( unsigned i = last - 1; i > first; --i )
+			std::swap( points[ i ], points[ first + rng.below( i - first + 1 ) ] );
+	}
+
+	// Plays games [first_game, last_game) on one thread, reusing one board and one policy throughout.
+	SimulationStats playGames( const SimulationConfig &config, const FleetPlacer &placer, ShotPolicy &policy, std::uint64_t first_game, std::uint64_t last_game )
+	{
+		SimulationStats stats;
+		Map map;
+		for( std::uint64_t game = first_game; game < last_game; ++game )
+		{
+			SplitMix64 rng{ gameSeed( config.seed, game ) };
+			map.clear();
+			++stats.games;
+			// A fleet that can't be placed has nothing to sink; that's not a win.
+			if( !placer.place( map, rng ) )
+			{
+				++stats.unfinished;
+				continue;
+			}
+			policy.reset( rng.next() );
+
+			unsigned attempts = 0;
+			while( !map.isGameOver() && attempts < MAX_SHOTS )
+			{
+				Point2D shot = policy.nextShot( map );
+				policy.onResult( shot, std::get< HitType >( map.checkShot( shot ) ) );
+				++attempts;
+			}
+
+			if( !map.isGameOver() )
+				++stats.unfinished;
+			else
+				++stats.shots_to_win[ map.pickedCount() ];
+		}
+		return stats;
+	}
+}
+
+void RandomShotPolicy::reset( std::uint64_t seed )
+{
+	for( unsigned i = 0; i < MAP_SIZE * MAP_SIZE; ++i )
+		mOrder[ i ] = { i % MAP_SIZE, i / MAP_SIZE };
+	SplitMix64 rng{ seed };
+	shuffle( mOrder, 0, MAP_SIZE * MAP_SIZE, rng );
+	mNext = 0;
+}
+
+Point2D RandomShotPolicy::nextShot( const Map & )
+{
+	Point2D shot = mOrder[ mNext ];
+	mNext = ( mNext + 1 ) % ( MAP_SIZE * MAP_SIZE );
+	return shot;
+}
+
+void HuntTargetShotPolicy::reset( std::uint64_t seed )
+{
+	// Every ship is at least two long, so it has to cover a point where x + y is even.
+	unsigned even = 0;
+	unsigned odd = ( MAP_SIZE * MAP_SIZE + 1 ) / 2;
+	for( unsigned i = 0; i < MAP_SIZE * MAP_SIZE; ++i )
+	{
+		Point2D point = { i % MAP_SIZE, i / MAP_SIZE };
+		mOrder[ ( point.x + point.y ) % 2 == 0 ? even++ : odd++ ] = point;
+	}
+	SplitMix64 rng{ seed };
+	shuffle( mOrder, 0, even, rng );
+	shuffle( mOrder, even, MAP_SIZE * MAP_SIZE, rng );
+	mNext = 0;
+	mTargetCount = 0;
+}
+
+Point2D HuntTargetShotPolicy::nextShot( const Map &map )
+{
+	while( mTargetCount > 0 )
+	{
+		Point2D target = mTargets[ --mTargetCount ];
+		if( map.getStatus( target ) != PointStatus::PICKED )
+			return target;
+	}
+
+	while( mNext < MAP_SIZE * MAP_SIZE && map.getStatus( mOrder[ mNext ] ) == PointStatus::PICKED )
+		++mNext;
+	return mOrder[ std::min( mNext, MAP_SIZE * MAP_SIZE - 1 ) ];
+}
+
+void HuntTargetShotPolicy::onResult( Point2D shot, HitType result )
+{
+	if( result != HitType::HIT && result != HitType::SUNK )
+		return;
+
+	if( shot.x > 0 )
+		mTargets[ mTargetCount++ ] = { shot.x - 1, shot.y };
+	if( shot.x + 1 < MAP_SIZE )
+		mTargets[ mTargetCount++ ] = { shot.x + 1, shot.y };
+	if( shot.y > 0 )
+		mTargets[ mTargetCount++ ] = { shot.x, shot.y - 1 };
+	if( shot.y + 1 < MAP_SIZE )
+		mTargets[ mTargetCount++ ] = { shot.x, shot.y + 1 };
+}
+
+Point2D DensityShotPolicy::nextShot( const Map &map )
+{
+	mView.update( map );
+	return mEngine.bestShot( mView );
+}
+
+double SimulationStats::meanShots() const
+{
+	std::uint64_t won = 0;
+	std::uint64_t total = 0;
+	for( unsigned shots = 0; shots < shots_to_win.size(); ++shots )
+	{
+		won += shots_to_win[ shots ];
+		total += shots_to_win[ shots ] * shots;
+	}
+	return won ? static_cast< double >( total ) / won : 0.0;
+}
+
+unsigned SimulationStats::percentile( double fraction ) const
+{
+	std::uint64_t won = games - unfinished;
+	std::uint64_t seen = 0;
+	for( unsigned shots = 0; shots < shots_to_win.size(); ++shots )
+	{
+		seen += shots_to_win[ shots ];
+		if( seen > 0 && seen >= fraction * won )
+			return shots;
+	}
+	return 0;
+}
+
+void SimulationStats::merge( const SimulationStats &other )
+{
+	games += other.games;
+	unfinished += other.unfinished;
+	for( unsigned shots = 0; shots < shots_to_win.size(); ++shots )
+		shots_to_win[ shots ] += other.shots_to_win[ shots ];
+}
+
+std::ostream &operator<<( std::ostream &out, const SimulationStats &stats )
+{
+	out << stats.games << " games, mean " << stats.meanShots() << " shots to win"
+		<< " (min " << stats.percentile( 0.0 ) << ", median " << stats.percentile( 0.5 )
+		<< ", p90 " << stats.percentile( 0.9 ) << ", max " << stats.percentile( 1.0 ) << ")";
+	if( stats.unfinished )
+		out << ", " << stats.unfinished << " unfinished";
+	out << ", " << static_cast< std::uint64_t >( stats.gamesPerSecondPerCore() ) << " games/sec/core";
+	return out;
+}
+
+SimulationStats runSimulation( const SimulationConfig &config, const ShotPolicyFactory &make_policy )
+{
+	unsigned threads = std::max( 1u, config.threads );
+	std::vector< std::unique_ptr< ShotPolicy > > policies;
+	for( unsigned t = 0; t < threads; ++t )
+		policies.push_back( make_policy() );
+	std::vector< SimulationStats > results( threads );
+	const FleetPlacer placer( config.fleet );
+
+	auto begin = std::chrono::steady_clock::now();
+	std::vector< std::thread > workers;
+	std::uint64_t band = ( config.games + threads - 1 ) / threads;
+	for( unsigned t = 0; t < threads; ++t )
+	{
+		std::uint64_t first = std::min( config.games, t * band );
+		std::uint64_t last = std::min( config.games, first + band );
+		workers.emplace_back( [&, t, first, last]()
+		{
+			results[ t ] = playGames( config, placer, *policies[ t ], first, last );
+		} );
+	}
+	for( auto &worker : workers )
+		worker.join();
+	std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - begin;
+
+	SimulationStats stats;
+	for( const auto &result : results )
+		stats.merge( result );
+	stats.seconds = elapsed.count();
+	stats.threads = threads;
+	return stats;
+}
@@ -0,0 +1,108 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <span>
+
+#include "ShipMap.h"
+#include "Targeting.h"
+#include "FleetPlacement.h"
+
+// Self-play: random fleets (see FleetPlacer), a pluggable shot policy, played until every ship is sunk.
+// Games are spread over worker threads, each reusing one Map and one policy, so a game
+// doesn't allocate. Every game is seeded from the run seed and its own index, so results
+// are the same whatever the thread count.
+
+// Decides where to shoot next. Each worker thread gets its own instance, reset before every game.
+class ShotPolicy
+{
+public:
+	virtual ~ShotPolicy() = default;
+
+	virtual void reset( std::uint64_t seed ) = 0;
+	// Must return a point on the board.
+	virtual Point2D nextShot( const Map &map ) = 0;
+	virtual void onResult( Point2D, HitType ) {}
+};
+
+using ShotPolicyFactory = std::function< std::unique_ptr< ShotPolicy >() >;
+
+// Shoots every point once, in a random order.
+class RandomShotPolicy : public ShotPolicy
+{
+public:
+	void reset( std::uint64_t seed ) override;
+	Point2D nextShot( const Map &map ) override;
+
+private:
+	std::array< Point2D, MAP_SIZE * MAP_SIZE > mOrder;
+	unsigned mNext = 0;
+};
+
+// Random shots on a checkerboard until something's hit, then works through the hit's neighbours.
+class HuntTargetShotPolicy : public ShotPolicy
+{
+public:
+	void reset( std::uint64_t seed ) override;
+	Point2D nextShot( const Map &map ) override;
+	void onResult( Point2D shot, HitType result ) override;
+
+private:
+	// Checkerboard points first, then the rest, each half shuffled.
+	std::array< Point2D, MAP_SIZE * MAP_SIZE > mOrder;
+	unsigned mNext = 0;
+	// Every hit pushes at most four neighbours.
+	std::array< Point2D, 4 * MAP_SIZE * MAP_SIZE > mTargets;
+	unsigned mTargetCount = 0;
+};
+
+// Always takes the TargetingEngine's best shot.
+class DensityShotPolicy : public ShotPolicy
+{
+public:
+	void reset( std::uint64_t ) override {}
+	Point2D nextShot( const Map &map ) override;
+
+private:
+	BoardView mView;
+	TargetingEngine mEngine;
+};
+
+struct SimulationConfig
+{
+	std::uint64_t games = 100000;
+	std::uint64_t seed = 0;
+	unsigned threads = 1;
+	std::span< const FleetEntry > fleet = STANDARD_FLEET;
+};
+
+struct SimulationStats
+{
+	std::uint64_t games = 0;
+	// Games where the policy ran out of shots (kept repeating points) before sinking everything,
+	// or where the fleet couldn't be placed at all.
+	std::uint64_t unfinished = 0;
+	// shots_to_win[ n ] is how many games were won in exactly n shots.
+	std::array< std::uint64_t, MAP_SIZE * MAP_SIZE + 1 > shots_to_win = {};
+	double seconds = 0.0;
+	unsigned threads = 1;
+
+	double meanShots() const;
+	// Smallest shot count that at least this fraction of games were won within.
+	unsigned percentile( double fraction ) const;
+	double gamesPerSecond() const { return seconds > 0.0 ? games / seconds : 0.0; }
+	double gamesPerSecondPerCore() const { return gamesPerSecond() / threads; }
+
+	void merge( const SimulationStats &other );
+};
+
+std::ostream &operator<<( std::ostream &out, const SimulationStats &stats );
+
+// Plays config.games games with policies from make_policy and returns the combined results.
+SimulationStats runSimulation( const SimulationConfig &config, const ShotPolicyFactory &make_policy );
+
+#endif
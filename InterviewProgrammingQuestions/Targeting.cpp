@@ -0,0 +1,278 @@
+#include "Targeting.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	// Extra weight for each known hit a placement covers, so that once something's
+	// been hit the placements through it dominate the heat map.
+	constexpr std::uint32_t HIT_WEIGHT = 32;
+
+	// Splits [0, count) into one contiguous band per thread and runs work( thread, first, last ) on each.
+	template< typename Work >
+	void forEachBand( unsigned threads, unsigned count, Work work )
+	{
+		threads = std::max( 1u, std::min( threads, count ) );
+		if( threads == 1 )
+		{
+			work( 0u, 0u, count );
+			return;
+		}
+
+		std::vector< std::thread > workers;
+		workers.reserve( threads - 1 );
+		unsigned band = ( count + threads - 1 ) / threads;
+		for( unsigned t = 1; t < threads; ++t )
+		{
+			unsigned first = std::min( count, t * band );
+			unsigned last = std::min( count, first + band );
+			workers.emplace_back( work, t, first, last );
+		}
+		work( 0u, 0u, std::min( count, band ) );
+		for( auto &worker : workers )
+			worker.join();
+	}
+}
+
+BoardView::BoardView( unsigned board_width, unsigned board_height ) :
+	width{ board_width }, height{ board_height }, cells( size_t{ board_width } * board_height, CellView::UNKNOWN )
+{
+}
+
+void BoardView::update( const Map &map )
+{
+	width = MAP_SIZE;
+	height = MAP_SIZE;
+	cells.assign( size_t{ MAP_SIZE } * MAP_SIZE, CellView::UNKNOWN );
+	remaining.clear();
+
+	// Picked points on a ship are hits, the rest are misses.
+	const auto &occupied = map.getOccupied();
+	for( Point2D point : map.getPicked() )
+		at( point ) = occupied.test( point ) ? CellView::HIT : CellView::MISS;
+
+	// Everyone can see which ships sank, but not where an unsunk ship is beyond the points already hit.
+	const auto &ships = map.getShips();
+	for( size_t i = 0; i < ships.size(); ++i )
+	{
+		if( !map.isShipSunk( i ) )
+		{
+			remaining.push_back( ships[ i ].length() );
+			continue;
+		}
+
+		const auto &start = ships[ i ].getStart();
+		for( unsigned j = 0; j < ships[ i ].length(); ++j )
+			at( ships[ i ].orthogonalX() ? Point2D{ start.x + j, start.y } : Point2D{ start.x, start.y + j } ) = CellView::SUNK;
+	}
+}
+
+BoardView BoardView::fromMap( const Map &map )
+{
+	BoardView view;
+	view.update( map );
+	return view;
+}
+
+TargetingEngine::TargetingEngine( unsigned threads ) : mThreads{ std::max( 1u, threads ) }, mScratch( mThreads )
+{
+}
+
+const std::vector< std::uint32_t > &TargetingEngine::computeDensity( const BoardView &view )
+{
+	mDensity.assign( view.cells.size(), 0u );
+
+	// Zero-length ships have no placements; dropping them here keeps both passes simple.
+	mLengths.clear();
+	for( auto length : view.remaining )
+	{
+		if( length == 0 )
+			continue;
+		auto found = std::find_if( mLengths.begin(), mLengths.end(), [length]( const auto &entry ) { return entry.first == length; } );
+		if( found == mLengths.end() )
+			mLengths.emplace_back( length, 1u );
+		else
+			++found->second;
+	}
+
+	// Rows and columns are independent of each other, so each thread owns a band of them
+	// and nobody writes the same point. Horizontal first, then vertical on top.
+	forEachBand( mThreads, view.height, [&]( unsigned thread, unsigned first, unsigned last )
+	{
+		accumulateRows( view, first, last, mScratch[ thread ] );
+	} );
+	size_t state_rows = 0;
+	for( const auto &entry : mLengths )
+		state_rows += 2 + entry.first;
+	mColumnRuns.assign( view.width, 0u );
+	mColumnState.assign( state_rows * view.width, 0u );
+	forEachBand( mThreads, view.width, [&]( unsigned, unsigned first, unsigned last )
+	{
+		accumulateColumns( view, first, last );
+	} );
+
+	// Placements may cover hits, but there's no point shooting those again.
+	for( size_t i = 0; i < mDensity.size(); ++i )
+	{
+		if( view.cells[ i ] != CellView::UNKNOWN )
+			mDensity[ i ] = 0;
+	}
+	return mDensity;
+}
+
+Point2D TargetingEngine::bestShot( const BoardView &view )
+{
+	const auto &density = computeDensity( view );
+
+	size_t best = density.size();
+	for( size_t i = 0; i < density.size(); ++i )
+	{
+		if( view.cells[ i ] != CellView::UNKNOWN )
+			continue;
+		if( best == density.size() || density[ i ] > density[ best ] )
+			best = i;
+	}
+
+	if( best == density.size() )
+		return {};
+	return { static_cast< unsigned >( best % view.width ), static_cast< unsigned >( best / view.width ) };
+}
+
+void TargetingEngine::accumulateLine( const CellView *cells, unsigned count, std::uint32_t *density, LineScratch &scratch ) const
+{
+	auto &runs = scratch.runs;
+	auto &hits = scratch.hits;
+	auto &weights = scratch.weights;
+	runs.resize( count );
+	hits.resize( count + 1 );
+	weights.resize( count + 1 );
+
+	// runs[ i ]: how many open points end at i (misses and sunk ships block a placement).
+	// hits[ i ]: prefix count of known hits before i.
+	std::uint32_t run = 0;
+	hits[ 0 ] = 0;
+	for( unsigned i = 0; i < count; ++i )
+	{
+		bool blocked = cells[ i ] == CellView::MISS || cells[ i ] == CellView::SUNK;
+		run = blocked ? 0 : run + 1;
+		runs[ i ] = run;
+		hits[ i + 1 ] = hits[ i ] + ( cells[ i ] == CellView::HIT ? 1u : 0u );
+	}
+
+	// Copies, not references: the stores below could alias a reference, which keeps the
+	// compiler from vectorising them.
+	for( auto [ length, ships ] : mLengths )
+	{
+		if( length > count )
+			continue;
+
+		// totals[ e + 1 ]: weight of the placement ending at e, or 0 if it isn't legal. Legal
+		// placements are exactly the ends with a run at least as long as the ship, so nothing
+		// ends before length - 1.
+		std::uint32_t *totals = weights.data();
+		std::fill( totals, totals + length, 0u );
+		for( size_t e = length - 1; e < count; ++e )
+		{
+			std::uint32_t covered_hits = hits[ e + 1 ] - hits[ e + 1 - length ];
+			totals[ e + 1 ] = ( runs[ e ] >= length ? ships : 0u ) * ( 1 + HIT_WEIGHT * covered_hits );
+		}
+
+		// Then totals[ e ] is the weight of every placement ending before e. Point x is covered
+		// by the placements ending in [x, x + length - 1], so its share is a difference of two
+		// totals. This add is the only loop carrying anything from one point to the next.
+		for( size_t e = 1; e <= count; ++e )
+			totals[ e ] += totals[ e - 1 ];
+		const std::uint32_t *ahead = totals + length;
+		size_t full = count + 1 - length;
+		for( size_t x = 0; x < full; ++x )
+			density[ x ] += ahead[ x ] - totals[ x ];
+		for( size_t x = full; x < count; ++x )
+			density[ x ] += totals[ count ] - totals[ x ];
+	}
+}
+
+void TargetingEngine::accumulateRows( const BoardView &view, unsigned first_row, unsigned last_row, LineScratch &scratch )
+{
+	for( unsigned y = first_row; y < last_row; ++y )
+	{
+		size_t offset = size_t{ y } * view.width;
+		accumulateLine( view.cells.data() + offset, view.width, mDensity.data() + offset, scratch );
+	}
+}
+
+void TargetingEngine::accumulateColumns( const BoardView &view, unsigned first_column, unsigned last_column )
+{
+	// Same sums as accumulateLine, but kept per column and streamed a row at a time so the
+	// board is read in memory order and the working set stays a few rows wide. For each
+	// length there's a running count of hits in the last `length` rows, a running sum of
+	// placement weights over the same window, and a ring of those rows' weights.
+	const size_t width = view.width;
+	std::uint32_t *runs = mColumnRuns.data();
+	unsigned longest = 0;
+	for( const auto &entry : mLengths )
+		longest = std::max( longest, entry.first );
+
+	for( unsigned e = 0; e + 1 < view.height + longest; ++e )
+	{
+		const CellView *row = ( e < view.height ) ? view.cells.data() + e * width : nullptr;
+		if( row )
+		{
+			for( unsigned x = first_column; x < last_column; ++x )
+			{
+				bool blocked = row[ x ] == CellView::MISS || row[ x ] == CellView::SUNK;
+				runs[ x ] = blocked ? 0 : runs[ x ] + 1;
+			}
+		}
+
+		// Copies, as in accumulateLine.
+		std::uint32_t *state = mColumnState.data();
+		for( auto [ length, ships ] : mLengths )
+		{
+			std::uint32_t *hits = state;
+			std::uint32_t *sums = state + width;
+			std::uint32_t *ring = state + ( 2 + e % length ) * width;
+			state += ( 2 + size_t{ length } ) * width;
+			if( length > view.height )
+				continue;
+
+			// Branches are outside the loops over x, so each loop is straight line code on
+			// separate columns.
+			if( row )
+			{
+				// The placement ending on row e covers rows [e - length + 1, e].
+				if( e >= length )
+				{
+					const CellView *leaving = row - length * width;
+					for( unsigned x = first_column; x < last_column; ++x )
+						hits[ x ] -= ( leaving[ x ] == CellView::HIT ? 1u : 0u );
+				}
+				for( unsigned x = first_column; x < last_column; ++x )
+				{
+					hits[ x ] += ( row[ x ] == CellView::HIT ? 1u : 0u );
+					std::uint32_t weight = ( runs[ x ] >= length ? ships : 0u ) * ( 1 + HIT_WEIGHT * hits[ x ] );
+					sums[ x ] += weight - ring[ x ];
+					ring[ x ] = weight;
+				}
+			}
+			else
+			{
+				// Past the bottom: no placements end here, the oldest just drop out.
+				for( unsigned x = first_column; x < last_column; ++x )
+				{
+					sums[ x ] -= ring[ x ];
+					ring[ x ] = 0;
+				}
+			}
+
+			// Point (x, y) is covered by the placements ending on rows [y, y + length - 1],
+			// which is exactly the window summed once row y + length - 1 has been added.
+			if( e + 1 >= length && e + 1 - length < view.height )
+			{
+				std::uint32_t *density = mDensity.data() + ( e + 1 - length ) * width;
+				for( unsigned x = first_column; x < last_column; ++x )
+					density[ x ] += sums[ x ];
+			}
+		}
+	}
+}
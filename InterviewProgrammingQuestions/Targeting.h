@@ -0,0 +1,82 @@
+#ifndef TARGETING_H
+#define TARGETING_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "ShipMap.h"
+
+// Picks the next shot by working out, for every unknown point, how many legal
+// placements of the remaining ships would cover it. Only uses what a player can
+// see: misses, hits, which ships have been sunk, and the lengths still afloat.
+
+enum class CellView : unsigned char
+{
+	UNKNOWN,
+	MISS,
+	// Hit, but the ship isn't sunk yet.
+	HIT,
+	SUNK
+};
+
+// A player's view of a board of any size, stored row-major (y * width + x).
+// Not tied to MAP_SIZE so large boards can be built directly.
+struct BoardView
+{
+	unsigned width = 0;
+	unsigned height = 0;
+	std::vector< CellView > cells;
+	// Lengths of the ships still afloat.
+	std::vector< unsigned > remaining;
+
+	BoardView() = default;
+	BoardView( unsigned board_width, unsigned board_height );
+
+	CellView &at( Point2D point ) { return cells[ point.y * width + point.x ]; }
+	CellView at( Point2D point ) const { return cells[ point.y * width + point.x ]; }
+
+	// Rebuilds the view from a map, reusing this view's storage.
+	void update( const Map &map );
+	static BoardView fromMap( const Map &map );
+};
+
+class TargetingEngine
+{
+public:
+	// threads > 1 splits each pass over the board between that many threads;
+	// only worth it on large boards.
+	explicit TargetingEngine( unsigned threads = 1 );
+
+	// Returns the placement-weighted heat map for the view, row-major like BoardView.
+	// Placements over a known hit count extra; points already picked are always 0.
+	// The returned reference is valid until the next call.
+	const std::vector< std::uint32_t > &computeDensity( const BoardView &view );
+
+	// The unknown point with the highest density. If nothing is unknown, returns (0, 0).
+	Point2D bestShot( const BoardView &view );
+
+private:
+	// Per-thread working space for one row of the board.
+	struct LineScratch
+	{
+		std::vector< std::uint32_t > runs;
+		std::vector< std::uint32_t > hits;
+		std::vector< std::uint32_t > weights;
+	};
+
+	unsigned mThreads;
+	std::vector< std::uint32_t > mDensity;
+	// Distinct remaining ship lengths, paired with how many ships have that length.
+	std::vector< std::pair< unsigned, unsigned > > mLengths;
+	std::vector< LineScratch > mScratch;
+	// Working space for the vertical pass, a few rows wide; threads own disjoint columns of it.
+	std::vector< std::uint32_t > mColumnRuns;
+	std::vector< std::uint32_t > mColumnState;
+
+	void accumulateLine( const CellView *cells, unsigned count, std::uint32_t *density, LineScratch &scratch ) const;
+	void accumulateRows( const BoardView &view, unsigned first_row, unsigned last_row, LineScratch &scratch );
+	void accumulateColumns( const BoardView &view, unsigned first_column, unsigned last_column );
+};
+
+#endif